@@ -0,0 +1,262 @@
+// 分配追踪的回放基准：用同一份追踪驱动不同的分配策略，比较吞吐量、峰值常驻内存与碎片率。
+// 用法：lab2_replay [追踪文件]。不给出文件时先录制一段合成负载到 alloc.trace 再回放。
+// 追踪按时间戳排序后在单个线程上回放。
+#include "yan_allocator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define REPLAY_ISOLATED
+#endif
+
+namespace my
+{
+    namespace test
+    {
+
+// 回放时的一次操作，块以槽位编号代替地址。
+struct replay_op
+{
+    std::uint64_t size;
+    std::uint32_t slot;
+    bool deallocate;
+};
+
+struct replay_plan
+{
+    std::vector<replay_op> ops;
+    std::size_t slots = 0;
+    std::size_t peak_live_bytes = 0;
+};
+
+// 把追踪记录整理成回放操作：按时间排序、配对分配与回收，
+// 丢弃无法配对的回收，并在末尾回收仍存活的块。
+replay_plan make_plan(std::vector<alloc_trace_record> records)
+{
+    std::stable_sort(records.begin(), records.end(), [](auto& a, auto& b) { return a.timestamp < b.timestamp; });
+    replay_plan plan;
+    plan.ops.reserve(records.size());
+    std::unordered_map<std::uint64_t, std::uint32_t> live;
+    std::vector<std::uint32_t> free_slots;
+    std::vector<std::uint64_t> slot_size;
+    std::size_t live_bytes = 0;
+    for (auto& r : records)
+    {
+        if (r.is_deallocate())
+        {
+            auto it = live.find(r.id);
+            if (it == live.end())
+            {
+                continue;
+            }
+            plan.ops.push_back({ slot_size[it->second], it->second, true });
+            live_bytes -= slot_size[it->second];
+            free_slots.push_back(it->second);
+            live.erase(it);
+        }
+        else
+        {
+            std::uint32_t slot;
+            if (!free_slots.empty())
+            {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            else
+            {
+                slot = static_cast<std::uint32_t>(slot_size.size());
+                slot_size.push_back(0);
+            }
+            slot_size[slot] = r.size();
+            if (auto [it, inserted] = live.try_emplace(r.id, slot); !inserted)
+            {
+                // 丢失了回收记录，旧的块就此泄漏。
+                it->second = slot;
+            }
+            plan.ops.push_back({ r.size(), slot, false });
+            live_bytes += r.size();
+            plan.peak_live_bytes = std::max(plan.peak_live_bytes, live_bytes);
+        }
+    }
+    for (auto& [id, slot] : live)
+    {
+        plan.ops.push_back({ slot_size[slot], slot, true });
+    }
+    plan.slots = slot_size.size();
+    return plan;
+}
+
+// 直接使用 malloc/free 的资源，代表系统堆。
+class malloc_resource : public memory_resource
+{
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        void* p = alignment <= alignof(std::max_align_t) ? std::malloc(bytes) : std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t, size_t) override
+    {
+        std::free(p);
+    }
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+struct replay_model
+{
+    const char* name;
+    std::unique_ptr<memory_resource> (*make)();
+};
+
+const replay_model models[] = {
+    { "system heap", [] { return std::unique_ptr<memory_resource>(new malloc_resource); } },
+    { "alloc_proxy", [] { return std::unique_ptr<memory_resource>(new _new_delete_resource); } },
+    { "pool", [] {
+        static malloc_resource upstream;
+        return std::unique_ptr<memory_resource>(new unsynchronized_pool_resource(&upstream)); } },
+    { "arena", [] { return std::unique_ptr<memory_resource>(new monotonic_buffer_resource); } },
+};
+
+long peak_rss_kib()
+{
+#ifdef REPLAY_ISOLATED
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// 回放一遍并输出一行结果。
+void run_model(const replay_model& model, const replay_plan& plan)
+{
+    std::vector<void*> slots(plan.slots);
+    const long rss_before = peak_rss_kib();
+    auto resource = model.make();
+    const auto begin = std::chrono::steady_clock::now();
+    for (auto& op : plan.ops)
+    {
+        if (op.deallocate)
+        {
+            resource->deallocate(slots[op.slot], op.size);
+        }
+        else
+        {
+            auto* p = static_cast<volatile char*>(resource->allocate(op.size));
+            // 每页写一次，让常驻内存反映实际占用。
+            for (std::uint64_t i = 0; i < op.size; i += 4096)
+            {
+                p[i] = 0;
+            }
+            slots[op.slot] = const_cast<char*>(p);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const long footprint = peak_rss_kib() - rss_before;
+    std::string rss = "-", fragmentation = "-";
+#ifdef REPLAY_ISOLATED
+    rss = std::to_string(footprint);
+    if (footprint > 0)
+    {
+        fragmentation = std::format("{:.1f}%", std::max(0.0, 100.0 * (1.0 - plan.peak_live_bytes / 1024.0 / footprint)));
+    }
+#endif
+    std::cout << std::format("{:<14}{:>12.2f}{:>18}{:>16}\n", model.name, plan.ops.size() / seconds / 1e6, rss, fragmentation) << std::flush;
+}
+
+// 录制一段合成负载：以小对象为主，夹杂中等与大块，存活时间随机。
+bool record_synthetic(const char* path)
+{
+    auto& ap = _alloc_proxy::get_instance();
+    if (!ap.tracer().start(path))
+    {
+        return false;
+    }
+    std::mt19937_64 rng(42);
+    std::vector<std::pair<void*, size_t>> live;
+    for (int i = 0; i < 500000; ++i)
+    {
+        if (!live.empty() && (live.size() > 20000 || rng() % 2 == 0))
+        {
+            std::swap(live[rng() % live.size()], live.back());
+            ap.deallocate(live.back().first, live.back().second);
+            live.pop_back();
+            continue;
+        }
+        const auto dice = rng() % 1000;
+        const size_t size = dice < 900 ? 8 + rng() % 512 : dice < 995 ? 1024 + rng() % 65536 : 256 * 1024 + rng() % (4 << 20);
+        live.emplace_back(ap.allocate(size), size);
+    }
+    for (auto& [p, size] : live)
+    {
+        ap.deallocate(p, size);
+    }
+    ap.tracer().stop();
+    return true;
+}
+
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace my::test;
+    const char* path = argc > 1 ? argv[1] : "alloc.trace";
+    if (argc <= 1 && !record_synthetic(path))
+    {
+        std::cerr << std::format("cannot record to `{}`\n", path);
+        return 1;
+    }
+    replay_plan plan = make_plan(my::load_alloc_trace(path));
+    if (plan.ops.empty())
+    {
+        std::cerr << std::format("`{}` is not a valid allocation trace\n", path);
+        return 1;
+    }
+    std::cout << std::format("{} operations, peak live bytes {} KiB\n", plan.ops.size(), plan.peak_live_bytes / 1024);
+    std::cout << std::format("{:<14}{:>12}{:>18}{:>16}\n", "model", "Mops/s", "peak RSS (KiB)", "fragmentation") << std::flush;
+    for (auto& model : models)
+    {
+#ifdef REPLAY_ISOLATED
+        // 每个策略在独立的子进程中回放，互不影响堆的状态与峰值常驻内存。
+        if (pid_t pid = fork(); pid == 0)
+        {
+            run_model(model, plan);
+            std::_Exit(0);
+        }
+        else if (pid > 0)
+        {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            continue;
+        }
+#endif
+        run_model(model, plan);
+    }
+    return 0;
+}
@@ -1,6 +1,13 @@
 #include "co_yantest.hpp"
 #include "int_wrapper.hpp"
+#include <atomic>
+#include <bit>
+#include <latch>
+#include <list>
 #include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 //#define USE_STD
 
@@ -8,8 +15,9 @@
 #define NAMESPACE_MY ::std::
 #else
 #include "yan_allocator.hpp"
+#include "yan_memory.hpp"
 #define NAMESPACE_MY ::my::
-auto& ap = _alloc_proxy::get_instance();
+auto& ap = my::_alloc_proxy::get_instance();
 #endif
 
 namespace my
@@ -133,6 +141,339 @@ case_t alloc_proxy()
     co_return;
 }
 
+case_t small_object_pool()
+{
+#ifndef USE_STD
+    co_yield "check size classes";
+    for (size_t n = 0; n <= _size_class::max_small; ++n)
+    {
+        size_t cls = _size_class::index(n);
+        size_t size = _size_class::size(cls);
+        if (size < n || size % _size_class::quantum != 0 || size != _size_class::round(n) || (cls != 0 && _size_class::size(cls - 1) >= n))
+        {
+            co_yield{ false, std::format("`{}` bytes should use the smallest fitting class that is a multiple of `{}`, but class `{}` of `{}` bytes is chosen", n, _size_class::quantum, cls, size) };
+        }
+    }
+    co_yield nullptr;
+
+    ap.reset_uncheck();
+    co_yield "allocate and deallocate 24 bytes twice";
+    void* p1 = ap.allocate(24);
+    ap.deallocate(p1, 24);
+    void* p2 = ap.allocate(24);
+    co_yield{ p1 == p2, "a freed block should be reused by the next allocation of the same class" };
+    ap.deallocate(p2, 24);
+    co_yield nullptr;
+
+    co_yield "allocate 1000 blocks of every size up to 4096 bytes and fill them";
+    std::vector<std::pair<unsigned char*, size_t>> blocks;
+    for (size_t size = 1; size <= 4096; size = size * 3 / 2 + 1)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            auto* p = static_cast<unsigned char*>(ap.allocate(size));
+            std::fill_n(p, size, static_cast<unsigned char>(size));
+            blocks.emplace_back(p, size);
+        }
+    }
+    co_yield{ ap.current_allocations == blocks.size(), std::format("alloc_proxy's current_allocations should be `{}`, but it actually is `{}`", blocks.size(), ap.current_allocations) };
+    bool intact = std::all_of(blocks.begin(), blocks.end(), [](auto& b) {
+        return std::all_of(b.first, b.first + b.second, [&](unsigned char c) { return c == static_cast<unsigned char>(b.second); });
+    });
+    co_yield{ intact, "blocks handed out by the pool should not overlap" };
+    for (auto& [p, size] : blocks) { ap.deallocate(p, size); }
+    blocks.clear();
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    co_yield{ ap.current_allocated_bytes == 0, std::format("alloc_proxy's current_allocated_bytes should be `0`, but it actually is `{}`", ap.current_allocated_bytes) };
+    co_yield nullptr;
+
+    co_yield "allocate on one thread and deallocate on another";
+    ap.reset();
+    std::vector<void*> ptrs;
+    std::thread([&] { for (int i = 0; i < 10000; ++i) { ptrs.push_back(ap.allocate(48)); } }).join();
+    std::thread([&] { for (void* p : ptrs) { ap.deallocate(p, 48); } }).join();
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    co_yield{ ap.total_allocated_bytes == 48 * 10000, std::format("alloc_proxy's total_allocated_bytes should be `{}`, but it actually is `{}`", 48 * 10000, ap.total_allocated_bytes) };
+    ap.reset();
+    co_yield nullptr;
+
+    co_yield "free a producer's blocks on a consumer thread";
+    std::vector<void*> produced, reproduced, consumed;
+    std::latch ready(1), freed(1);
+    std::thread producer([&] {
+        for (int i = 0; i < 1000; ++i) { produced.push_back(ap.allocate(6000)); }
+        ready.count_down();
+        freed.wait();
+        for (int i = 0; i < 1000; ++i) { reproduced.push_back(ap.allocate(6000)); }
+        for (void* p : reproduced) { ap.deallocate(p, 6000); }
+    });
+    std::thread consumer([&] {
+        ready.wait();
+        for (void* p : produced) { ap.deallocate(p, 6000); }
+        for (int i = 0; i < 1000; ++i) { consumed.push_back(ap.allocate(6000)); }
+        for (void* p : consumed) { ap.deallocate(p, 6000); }
+        freed.count_down();
+    });
+    producer.join();
+    consumer.join();
+    std::sort(produced.begin(), produced.end());
+    auto overlap = [&](std::vector<void*>& v) {
+        return std::count_if(v.begin(), v.end(), [&](void* p) { return std::binary_search(produced.begin(), produced.end(), p); });
+    };
+    co_yield{ overlap(consumed) == 0, std::format("blocks freed by the consumer should go back to the producer, but the consumer reused `{}` of them", overlap(consumed)) };
+    co_yield{ overlap(reproduced) == 1000, std::format("the producer should get all `1000` blocks back, but it only reused `{}` of them", overlap(reproduced)) };
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    ap.reset();
+    co_yield nullptr;
+
+    co_yield "allocate large blocks straight from the operating system";
+#ifdef YAN_ALLOC_HUGE_PAGES
+    void* page = _large_pages::allocate(3 * 1024 * 1024 + 1);
+    co_yield{ reinterpret_cast<std::uintptr_t>(page) % _large_pages::huge_page_bytes == 0, "a block spanning huge pages should be aligned to a huge page" };
+    _large_pages::deallocate(page, 3 * 1024 * 1024 + 1);
+#endif
+    void* cached = _large_pages::allocate(1024 * 1024);
+    _large_pages::deallocate(cached, 1024 * 1024);
+    void* reused = _large_pages::allocate(1024 * 1024 - 4096);
+    co_yield{ reused == cached, "a freed mapping should be reused by the next request of the same size class" };
+    _large_pages::deallocate(reused, 1024 * 1024 - 4096);
+    // 超出驻留上限的映射交还页面后才进入缓存，再次取出时内容已清零。
+    constexpr size_t big = 32 * 1024 * 1024;
+    unsigned char* big_blocks[3];
+    for (auto& block : big_blocks)
+    {
+        block = static_cast<unsigned char*>(_large_pages::allocate(big));
+        block[0] = 0x5a;
+    }
+    for (auto* block : big_blocks)
+    {
+        _large_pages::deallocate(block, big);
+    }
+    auto* released = static_cast<unsigned char*>(_large_pages::allocate(big));
+    co_yield{ released == big_blocks[2] && released[0] == 0, "a mapping cached beyond the resident limit should have its pages released" };
+    _large_pages::deallocate(released, big);
+    _large_pages::trim();
+    for (size_t size : { _large_pages::threshold, _large_pages::threshold * 3 + 5, size_t(8 * 1024 * 1024) })
+    {
+        auto* p = static_cast<unsigned char*>(ap.allocate(size));
+        std::fill_n(p, size, static_cast<unsigned char>(0x5a));
+        co_yield{ ap.current_allocated_bytes == size, std::format("alloc_proxy's current_allocated_bytes should be `{}`, but it actually is `{}`", size, ap.current_allocated_bytes) };
+        co_yield{ p[0] == 0x5a && p[size - 1] == 0x5a, "a large block should be readable and writable to its end" };
+        ap.deallocate(p, size);
+    }
+    co_yield{ ap.current_allocations == 0 && ap.total_allocations == 3, std::format("alloc_proxy's current_allocations and total_allocations should be `0` and `3`, but they actually are `{}` and `{}`", ap.current_allocations, ap.total_allocations) };
+    ap.reset();
+#endif
+    co_return;
+}
+
+case_t sharded_stats()
+{
+#ifndef USE_STD
+    ap.reset_uncheck();
+    co_yield "allocate on 8 threads concurrently, keep half of the blocks";
+    constexpr size_t threads = 8, rounds = 20000;
+    std::vector<std::vector<void*>> kept(threads);
+    {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t] {
+                for (size_t i = 0; i < rounds; ++i)
+                {
+                    void* p = ap.allocate(t + 1);
+                    if (i % 2 == 0) { kept[t].push_back(p); }
+                    else { ap.deallocate(p, t + 1); }
+                }
+            });
+        }
+        for (auto& w : workers) { w.join(); }
+    }
+    auto stats = ap.snapshot();
+    co_yield{ stats.total_allocations == threads * rounds, std::format("snapshot().total_allocations should be `{}`, but it actually is `{}`", threads * rounds, stats.total_allocations) };
+    co_yield{ stats.current_allocations == threads * rounds / 2, std::format("snapshot().current_allocations should be `{}`, but it actually is `{}`", threads * rounds / 2, stats.current_allocations) };
+    co_yield{ stats.total_allocated_bytes == rounds * threads * (threads + 1) / 2, std::format("snapshot().total_allocated_bytes should be `{}`, but it actually is `{}`", rounds * threads * (threads + 1) / 2, stats.total_allocated_bytes) };
+    co_yield{ ap.current_allocated_bytes == rounds / 2 * threads * (threads + 1) / 2, std::format("alloc_proxy's current_allocated_bytes should be `{}`, but it actually is `{}`", rounds / 2 * threads * (threads + 1) / 2, ap.current_allocated_bytes) };
+
+    co_yield "reset";
+    try {
+        ap.reset();
+        co_yield{ false, "reset should have thrown memory_leak exception, but it did not" };
+    }
+    catch (const _alloc_proxy::memory_leak&) {}
+
+    co_yield "deallocate the kept blocks on other threads and reset";
+    {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t] { for (void* p : kept[threads - 1 - t]) { ap.deallocate(p, threads - t); } });
+        }
+        for (auto& w : workers) { w.join(); }
+    }
+    ap.reset();
+    co_yield{ ap.total_allocations == 0, std::format("alloc_proxy's total_allocations should be `0`, but it actually is `{}`", ap.total_allocations) };
+#endif
+    co_return;
+}
+
+case_t alloc_profile()
+{
+#if defined(USE_STD) || !defined(YAN_ALLOC_PROFILE)
+    co_yield { case_t::state::DISMISSED, "test for allocation profiling has been dismissed, define YAN_ALLOC_PROFILE to enable it." };
+#else
+    auto& profiler = ap.profiler();
+    ap.reset_uncheck();
+    profiler.reset();
+    size_t base_peak = profiler.peak_bytes();
+
+    co_yield "allocate 100 blocks of 24 bytes and 10 blocks of 100000 bytes";
+    std::vector<std::pair<void*, size_t>> blocks;
+    for (int i = 0; i < 100; ++i) { blocks.emplace_back(ap.allocate(24), 24); }
+    for (int i = 0; i < 10; ++i) { blocks.emplace_back(ap.allocate(100000), 100000); }
+    co_yield{ ap.current_allocated_bytes == 100 * 24 + 10 * 100000, std::format("profiling should not change accounting, alloc_proxy's current_allocated_bytes should be `{}`, but it actually is `{}`", 100 * 24 + 10 * 100000, ap.current_allocated_bytes) };
+    size_t small = _alloc_profiler::bin(24), large = _alloc_profiler::bin(100000);
+    co_yield{ profiler.allocations(small) == 100, std::format("there should be `100` allocations in the size class of 24 bytes, but it actually is `{}`", profiler.allocations(small)) };
+    co_yield{ profiler.allocations(large) == 10, std::format("there should be `10` allocations in the bin of 100000 bytes, but it actually is `{}`", profiler.allocations(large)) };
+    co_yield{ _alloc_profiler::bin_size(large) >= 100000 && _alloc_profiler::bin_size(large) < 200000, std::format("the bin of 100000 bytes should be bounded by `131072`, but it actually is `{}`", _alloc_profiler::bin_size(large)) };
+
+    co_yield "deallocate them";
+    for (auto& [p, size] : blocks) { ap.deallocate(p, size); }
+    co_yield{ profiler.frees(small) == 100 && profiler.frees(large) == 10, std::format("there should be `100` and `10` frees, but it actually is `{}` and `{}`", profiler.frees(small), profiler.frees(large)) };
+    co_yield{ profiler.peak_bytes() - base_peak == 100 * 24 + 10 * 100000, std::format("peak bytes should grow by `{}`, but it actually grows by `{}`", 100 * 24 + 10 * 100000, profiler.peak_bytes() - base_peak) };
+    size_t lifetimes = 0;
+    for (size_t i = 0; i < _alloc_profiler::lifetime_buckets; ++i) { lifetimes += profiler.lifetimes(i); }
+    co_yield{ lifetimes == 110, std::format("all `110` frees should fall in a lifetime bucket, but only `{}` do", lifetimes) };
+
+    co_yield "dump the profile";
+    std::string text = profiler.report(), json = profiler.report(profile_format::json);
+    std::cout << text << "\n" << json << "\n";
+    co_yield{ text.find("peak bytes") != std::string::npos, "text report should contain peak bytes" };
+    co_yield{ json.starts_with("{\"peak_bytes\":") && json.ends_with("}}"), "json report should be an object starting with peak_bytes" };
+    ap.reset();
+#endif
+    co_return;
+}
+
+case_t alloc_trace()
+{
+#if defined(USE_STD) || !defined(YAN_ALLOC_TRACE)
+    co_yield { case_t::state::DISMISSED, "test for allocation tracing has been dismissed, define YAN_ALLOC_TRACE to enable it." };
+#else
+    const char* path = "lab2.alloc.trace";
+    co_yield "record 150 allocations on three threads, the last reusing a finished thread's buffer";
+    co_yield{ ap.tracer().start(path), std::format("tracing should start writing to `{}`", path) };
+    co_yield{ !ap.tracer().start(path), "tracing should not start twice" };
+    auto work = [] {
+        std::vector<void*> ptrs;
+        for (size_t i = 1; i <= 50; ++i) { ptrs.push_back(ap.allocate(i * 8)); }
+        for (size_t i = 1; i <= 50; ++i) { ap.deallocate(ptrs[i - 1], i * 8); }
+    };
+    work();
+    std::thread(work).join();
+    std::thread(work).join();
+    ap.tracer().stop();
+    void* untraced = ap.allocate(8);
+    ap.deallocate(untraced, 8);
+
+    co_yield "load the trace";
+    auto records = load_alloc_trace(path);
+    std::remove(path);
+    co_yield{ records.size() == 300, std::format("the trace should hold `300` records, but it actually holds `{}`", records.size()) };
+    size_t allocations = 0, bytes = 0, threads_mask = 0;
+    std::unordered_map<std::uint64_t, std::uint64_t> live;
+    bool paired = true;
+    for (auto& r : records)
+    {
+        threads_mask |= size_t(1) << (r.thread() % 64);
+        if (r.is_deallocate())
+        {
+            auto it = live.find(r.id);
+            paired = paired && it != live.end() && it->second == r.size() && r.timestamp > 0;
+            if (it != live.end()) { live.erase(it); }
+        }
+        else
+        {
+            ++allocations;
+            bytes += r.size();
+            live[r.id] = r.size();
+        }
+    }
+    co_yield{ allocations == 150 && bytes == 3 * 8 * 50 * 51 / 2, std::format("the trace should hold `150` allocations of `{}` bytes, but it actually holds `{}` of `{}` bytes", 3 * 8 * 50 * 51 / 2, allocations, bytes) };
+    co_yield{ paired && live.empty(), "every deallocation should pair with an earlier allocation of the same size" };
+    co_yield{ std::popcount(threads_mask) == 3 && (threads_mask & 1) == 0, "records from the three threads should carry different non-zero thread ids" };
+    co_yield nullptr;
+
+    co_yield "record allocations made after a thread has given back its buffer";
+    // 比追踪缓冲区更早构造，因而在缓冲区交还之后才析构
+    struct late_allocation
+    {
+        ~late_allocation() { ap.deallocate(ap.allocate(24), 24); }
+    };
+    co_yield{ ap.tracer().start(path), std::format("tracing should start writing to `{}`", path) };
+    std::thread([] {
+        thread_local late_allocation late;
+        (void)late;
+        ap.deallocate(ap.allocate(8), 8);
+    }).join();
+    ap.tracer().stop();
+    records = load_alloc_trace(path);
+    std::remove(path);
+    const auto late_records = std::count_if(records.begin(), records.end(), [](auto& r) { return r.size() == 24 && r.thread() == 0; });
+    co_yield{ records.size() == 4 && late_records == 2, std::format("the trace should hold `4` records with `2` from the retired thread, but it actually holds `{}` with `{}`", records.size(), late_records) };
+#endif
+    co_return;
+}
+
+case_t alloc_sample()
+{
+#if defined(USE_STD) || !defined(YAN_ALLOC_SAMPLE)
+    co_yield { case_t::state::DISMISSED, "test for allocation sampling has been dismissed, define YAN_ALLOC_SAMPLE to enable it." };
+#else
+    auto& sampler = ap.sampler();
+    auto estimated = [&] {
+        size_t total = 0;
+        for (auto& stack : sampler.live()) { total += stack.estimated_bytes; }
+        return total;
+    };
+    const size_t interval = sampler.interval();
+    const size_t before = estimated();
+
+    co_yield "allocate 1000 blocks of 1024 bytes, sampling every 4096 bytes on average";
+    sampler.set_interval(4096);
+    std::vector<void*> ptrs;
+    for (size_t i = 0; i < 1000; ++i) { ptrs.push_back(ap.allocate(1024)); }
+    const size_t sampled = estimated() - before;
+    co_yield{ sampled > 750 * 1024 && sampled < 1250 * 1024, std::format("the estimated live bytes should be about `{}`, but it actually is `{}`", 1000 * 1024, sampled) };
+    auto stacks = sampler.live();
+    co_yield{ !stacks.empty() && stacks.front().samples > 0 && stacks.front().bytes == stacks.front().samples * 1024, "the heaviest stack should consist of the sampled blocks of 1024 bytes" };
+    co_yield{ sampler.report().starts_with("estimated live bytes: "), "the report should start with the estimated live bytes" };
+
+    co_yield "deallocate them";
+    for (void* p : ptrs) { ap.deallocate(p, 1024); }
+    co_yield{ estimated() == before, std::format("the estimated live bytes should return to `{}`, but it actually is `{}`", before, estimated()) };
+
+    co_yield "grow a sampled block in place and then by moving it";
+    auto sampled_bytes = [&] {
+        size_t total = 0;
+        for (auto& stack : sampler.live()) { total += stack.bytes; }
+        return total;
+    };
+    const size_t base = sampled_bytes();
+    sampler.set_interval(1);
+    void* p = ap.allocate(200);
+    co_yield{ sampled_bytes() - base == 200, std::format("the block should be sampled with `200` bytes, but `{}` bytes are sampled", sampled_bytes() - base) };
+    const bool expanded = ap.try_expand(p, 200, 208);
+    co_yield{ expanded && sampled_bytes() - base == 208, std::format("in-place growth should update the sample to `208` bytes, but `{}` bytes are sampled", sampled_bytes() - base) };
+    p = ap.reallocate(p, 208, 100000);
+    co_yield{ sampled_bytes() - base == 100000, std::format("the moved block should be sampled with `100000` bytes, but `{}` bytes are sampled", sampled_bytes() - base) };
+    ap.deallocate(p, 100000);
+    sampler.set_interval(interval);
+    co_yield{ sampled_bytes() == base, "deallocating the block should drop its sample" };
+#endif
+    co_return;
+}
+
 case_t allocator_test()
 {
 #ifndef USE_STD
@@ -175,6 +516,529 @@ case_t allocator_test()
     co_return;
 }
 
+case_t arena()
+{
+#ifndef USE_STD
+    using Alloc = arena_allocator<int_wrapper>;
+    using T = allocator_traits<Alloc>;
+    co_yield{ std::is_same_v<T::is_always_equal, std::false_type>, "arena_allocator is stateful, my::allocator_traits<arena_allocator>::is_always_equal should be std::false_type" };
+    co_yield{ std::is_same_v<T::rebind_alloc<double>, arena_allocator<double>>, "my::allocator_traits<arena_allocator<int_wrapper>>::rebind_alloc<double> should be arena_allocator<double>" };
+
+    ap.reset_uncheck();
+    auto c = int_wrapper::counter_scope();
+    {
+        arena_resource arena(1024);
+        Alloc alloc(arena);
+        co_yield "allocate and construct 10 objects from the arena";
+        auto* p = T::allocate(alloc, 10);
+        for (int i = 0; i < 10; ++i) { T::construct(alloc, p + i, i); }
+        co_yield{ ap.current_allocations == 1, std::format("the arena should hold `1` chunk from alloc_proxy, but alloc_proxy's current_allocations is `{}`", ap.current_allocations) };
+        co_yield{ reinterpret_cast<std::uintptr_t>(p) % alignof(int_wrapper) == 0, "memory from the arena should be properly aligned" };
+
+        co_yield "destroy and deallocate them";
+        for (int i = 0; i < 10; ++i) { T::destroy(alloc, p + i); }
+        size_t bytes = ap.current_allocated_bytes;
+        T::deallocate(alloc, p, 10);
+        co_yield{ ap.current_allocated_bytes == bytes, "deallocate on arena_allocator should be a no-op" };
+
+        co_yield "allocate 10000 ints in an arena_scope";
+        {
+            arena_scope scope(arena);
+            std::vector<int, arena_allocator<int>> v(arena);
+            for (int i = 0; i < 10000; ++i) { v.push_back(i); }
+            co_yield{ v[9999] == 9999, "std::vector with arena_allocator should work" };
+            co_yield{ ap.current_allocations > 1, "the arena should have grown with more chunks" };
+            auto* q = static_cast<char*>(arena.allocate(1, 64));
+            co_yield{ reinterpret_cast<std::uintptr_t>(q) % 64 == 0, "arena_resource::allocate(1, 64) should return 64-byte aligned memory" };
+        }
+        co_yield{ ap.current_allocations <= 2, std::format("leaving the arena_scope should give back all but one spare chunk, but `{}` chunks are held", ap.current_allocations) };
+
+        co_yield "allocate again after the scope";
+        auto* p2 = T::allocate(alloc, 1);
+        co_yield{ p2 == p + 10, "the arena should continue from where the scope began" };
+    }
+    co_yield{ ap.current_allocations == 0, std::format("destroying the arena should give back all chunks, but alloc_proxy's current_allocations is `{}`", ap.current_allocations) };
+    ap.reset();
+#endif
+    co_return;
+}
+
+#ifndef USE_STD
+// 转发给上游并记录申请次数的资源。
+class counting_resource : public memory_resource
+{
+public:
+    explicit counting_resource(memory_resource* upstream) noexcept : upstream(upstream) {}
+
+    memory_resource* upstream;
+    size_t allocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+#endif
+
+case_t polymorphic()
+{
+#ifndef USE_STD
+    using Alloc = polymorphic_allocator<int_wrapper>;
+    using T = allocator_traits<Alloc>;
+    co_yield{ std::is_same_v<T::is_always_equal, std::false_type>, "my::allocator_traits<polymorphic_allocator>::is_always_equal should be std::false_type" };
+    co_yield{ std::is_same_v<T::propagate_on_container_copy_assignment, std::false_type> && std::is_same_v<T::propagate_on_container_move_assignment, std::false_type> && std::is_same_v<T::propagate_on_container_swap, std::false_type>, "polymorphic_allocator should not propagate on assignment or swap" };
+    co_yield{ std::is_same_v<T::rebind_alloc<double>, polymorphic_allocator<double>>, "my::allocator_traits<polymorphic_allocator<int_wrapper>>::rebind_alloc<double> should be polymorphic_allocator<double>" };
+
+    ap.reset_uncheck();
+    auto c = int_wrapper::counter_scope();
+    {
+        monotonic_buffer_resource monotonic(1024);
+        unsynchronized_pool_resource pool;
+        co_yield{ pool.upstream_resource() == get_default_resource() && get_default_resource() == new_delete_resource(), "the default resource should be new_delete_resource()" };
+
+        co_yield "select_on_container_copy_construction";
+        Alloc alloc(&monotonic);
+        co_yield{ T::select_on_container_copy_construction(alloc).resource() == get_default_resource(), "a copied container should use the default resource" };
+        co_yield{ alloc != Alloc(&pool) && alloc == polymorphic_allocator<double>(&monotonic), "polymorphic_allocators should be equal iff their resources are equal" };
+
+        co_yield "allocate and construct 10 objects from a monotonic_buffer_resource";
+        auto* p = T::allocate(alloc, 10);
+        for (int i = 0; i < 10; ++i) { T::construct(alloc, p + i, i); }
+        co_yield{ int_wrapper::current_object_count == 10 && p[9] == 9, "objects should be constructed in memory from the resource" };
+        for (int i = 0; i < 10; ++i) { T::destroy(alloc, p + i); }
+        T::deallocate(alloc, p, 10);
+
+        co_yield "switch the same vector type between resources at runtime";
+        for (memory_resource* r : { static_cast<memory_resource*>(&monotonic), static_cast<memory_resource*>(&pool), new_delete_resource() })
+        {
+            std::vector<int, polymorphic_allocator<int>> v(r);
+            for (int i = 0; i < 10000; ++i) { v.push_back(i); }
+            co_yield{ v[9999] == 9999 && v.get_allocator().resource() == r, "std::vector with polymorphic_allocator should work with any resource" };
+        }
+        co_yield{ ap.current_allocations > 0, "pool and monotonic resources should hold memory until release" };
+
+        co_yield "reuse blocks in unsynchronized_pool_resource";
+        void* b1 = pool.allocate(24);
+        pool.deallocate(b1, 24);
+        void* b2 = pool.allocate(20);
+        co_yield{ b1 == b2, "a freed block should be reused by the next allocation of the same class" };
+        pool.deallocate(b2, 20);
+
+        co_yield "allocate from null_memory_resource";
+        bool thrown = false;
+        try { (void)null_memory_resource()->allocate(1); } catch (const std::bad_alloc&) { thrown = true; }
+        co_yield{ thrown, "null_memory_resource should throw std::bad_alloc" };
+        co_yield nullptr;
+
+        co_yield "allocate from a caller's buffer, then from a pool resource upstream";
+        std::byte buffer[256];
+        counting_resource counter(&pool);
+        {
+            monotonic_buffer_resource local(buffer, sizeof(buffer), &counter);
+            co_yield{ local.upstream_resource() == &counter, "upstream_resource should be the resource given to the constructor" };
+            bool inside = true;
+            void* first = nullptr;
+            for (int i = 0; i < 8; ++i)
+            {
+                auto* q = static_cast<std::byte*>(local.allocate(16));
+                inside = inside && q >= buffer && q + 16 <= buffer + sizeof(buffer);
+                first = first ? first : q;
+            }
+            co_yield{ inside && counter.allocations == 0, "the first 128 bytes should come from the buffer" };
+            void* spilled = local.allocate(200);
+            co_yield{ counter.allocations == 1, std::format("overflowing the buffer should take `1` chunk from upstream, but it takes `{}`", counter.allocations) };
+            local.release();
+            void* restarted = local.allocate(16);
+            co_yield{ restarted == first, "release should start over from the buffer" };
+            (void)local.allocate(16 * 7);
+            void* respilled = local.allocate(200);
+            co_yield{ respilled == spilled && counter.allocations == 2, "after release the pool should hand the same chunk back" };
+        }
+        co_yield nullptr;
+
+        co_yield "construct nested containers with the outer allocator";
+        using inner = std::vector<int, polymorphic_allocator<int>>;
+        {
+            std::vector<inner, polymorphic_allocator<inner>> outer(&monotonic);
+            outer.emplace_back(3, 7);
+            outer.emplace_back();
+            co_yield{ outer[0].get_allocator().resource() == &monotonic && outer[1].get_allocator().resource() == &monotonic && outer[0][2] == 7, "elements should be constructed with the container's resource" };
+        }
+        polymorphic_allocator<> bytes(&monotonic);
+        auto* pair = bytes.new_object<std::pair<int, inner>>();
+        co_yield{ pair->second.get_allocator().resource() == &monotonic, "new_object should pass the resource to pair members that use allocators" };
+        bytes.delete_object(pair);
+        auto* w = bytes.new_object<int_wrapper>(5);
+        co_yield{ *w == 5 && int_wrapper::current_object_count == 1, "new_object should construct the object" };
+        bytes.delete_object(w);
+        co_yield{ int_wrapper::current_object_count == 0, "delete_object should destroy the object" };
+    }
+    co_yield{ ap.current_allocations == 0, std::format("destroying the resources should give back all memory, but alloc_proxy's current_allocations is `{}`", ap.current_allocations) };
+    ap.reset();
+#endif
+    co_return;
+}
+
+struct alignas(64) cache_line_slot
+{
+    int value;
+};
+
+case_t over_aligned()
+{
+#ifndef USE_STD
+    ap.reset_uncheck();
+    co_yield "allocate over-aligned types with my::allocator";
+    allocator<cache_line_slot> slots;
+    for (size_t n : { size_t(1), size_t(3), size_t(100), size_t(1000), size_t(5000) })
+    {
+        cache_line_slot* p = slots.allocate(n);
+        co_yield{ reinterpret_cast<std::uintptr_t>(p) % 64 == 0, std::format("allocate({}) should return 64-byte aligned memory for alignas(64) types", n) };
+        co_yield{ ap.current_allocated_bytes == n * 64, std::format("alloc_proxy's current_allocated_bytes should be `{}`, but it actually is `{}`", n * 64, ap.current_allocated_bytes) };
+        slots.deallocate(p, n);
+    }
+    {
+        std::vector<cache_line_slot, allocator<cache_line_slot>> v(100);
+        co_yield{ reinterpret_cast<std::uintptr_t>(v.data()) % 64 == 0, "std::vector of alignas(64) types should be aligned" };
+    }
+    co_yield nullptr;
+
+    co_yield "request cache-line and page alignment per allocation";
+    using T = allocator_traits<allocator<double>>;
+    allocator<double> alloc;
+    for (size_t n : { size_t(1), size_t(7), size_t(1000), size_t(100000) })
+    {
+        double* a = T::allocate(alloc, n, cache_line_alignment);
+        double* b = T::allocate(alloc, n, page_alignment);
+        co_yield{ reinterpret_cast<std::uintptr_t>(a) % 64 == 0, std::format("allocate({}, cache_line_alignment) should return 64-byte aligned memory", n) };
+        co_yield{ reinterpret_cast<std::uintptr_t>(b) % 4096 == 0, std::format("allocate({}, page_alignment) should return 4096-byte aligned memory", n) };
+        std::fill_n(a, n, 1.0);
+        std::fill_n(b, n, 2.0);
+        T::deallocate(alloc, a, n, cache_line_alignment);
+        T::deallocate(alloc, b, n, page_alignment);
+    }
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    co_yield{ ap.current_allocated_bytes == 0, std::format("alloc_proxy's current_allocated_bytes should be `0`, but it actually is `{}`", ap.current_allocated_bytes) };
+    co_yield nullptr;
+
+    co_yield "over-aligned allocation through an allocator without such support";
+    shit_allocator<int> shit;
+    bool thrown = false;
+    try { (void)allocator_traits<shit_allocator<int>>::allocate(shit, 1, cache_line_alignment); } catch (const std::bad_alloc&) { thrown = true; }
+    co_yield{ thrown, "my::allocator_traits::allocate should throw std::bad_alloc if the alignment cannot be honoured" };
+    ap.reset();
+#endif
+    co_return;
+}
+
+case_t accounting_policy()
+{
+#ifndef USE_STD
+    using Counted = allocator<int, pow2_rounding, counter_accounting>;
+    using Raw = allocator<int, pow2_rounding, no_accounting>;
+    co_yield{ std::is_same_v<allocator_traits<Raw>::rebind_alloc<double>, allocator<double, pow2_rounding, no_accounting>>, "rebind_alloc should keep the accounting policy" };
+    co_yield{ std::is_same_v<allocator_traits<Raw>::is_always_equal, std::true_type>, "my::allocator_traits<allocator<int, pow2_rounding, no_accounting>>::is_always_equal should be std::true_type" };
+    co_yield{ Raw() == allocator<double, size_class_rounding, no_accounting>() && Counted() == allocator<char, pow2_rounding, counter_accounting>(), "allocators with the same accounting policy should compare equal across rebinds" };
+    co_yield{ Raw() != allocator<int>() && Counted() != Raw(), "allocators with different accounting policies should not compare equal" };
+
+    ap.reset_uncheck();
+#ifdef YAN_ALLOC_PROFILE
+    auto& profiler = ap.profiler();
+    profiler.reset();
+#endif
+    co_yield "allocate with counter_accounting";
+    Counted counted;
+    int* p = allocator_traits<Counted>::allocate(counted, 100);
+    co_yield{ ap.current_allocated_bytes == 100 * sizeof(int) && ap.current_allocations == 1, std::format("counter_accounting should be counted, but alloc_proxy's current_allocated_bytes is `{}`", ap.current_allocated_bytes) };
+#ifdef YAN_ALLOC_PROFILE
+    co_yield{ profiler.allocations(_alloc_profiler::bin(100 * sizeof(int))) == 0, "counter_accounting should not be profiled" };
+#endif
+    allocator_traits<Counted>::deallocate(counted, p, 100);
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    co_yield nullptr;
+
+    co_yield "allocate with no_accounting";
+    std::vector<int, Raw> v;
+    for (int i = 0; i < 10000; ++i) { v.push_back(i); }
+    co_yield{ v[9999] == 9999, "std::vector with no_accounting should work" };
+    co_yield{ ap.total_allocations == 1, std::format("no_accounting should not be counted, but alloc_proxy's total_allocations is `{}`", ap.total_allocations) };
+    ap.reset();
+#endif
+    co_return;
+}
+
+#ifndef USE_STD
+// 元素类型在 vector<pool_node, ...> 实例化时还不完整
+struct pool_node
+{
+    std::vector<pool_node, pool_allocator<pool_node>> kids;
+};
+#endif
+
+case_t object_pool_test()
+{
+#ifndef USE_STD
+    ap.reset_uncheck();
+    auto c = int_wrapper::counter_scope();
+    {
+        object_pool<int_wrapper> pool;
+        co_yield "create and destroy objects in an object_pool";
+        int_wrapper* p1 = pool.create(1);
+        co_yield{ *p1 == 1 && int_wrapper::current_object_count == 1, "object_pool::create should construct the object" };
+        co_yield{ ap.current_allocations == 1, std::format("the pool should hold `1` slab from alloc_proxy, but alloc_proxy's current_allocations is `{}`", ap.current_allocations) };
+        pool.destroy(p1);
+        int_wrapper* p2 = pool.create(2);
+        co_yield{ p1 == p2 && int_wrapper::current_object_count == 1, "a destroyed object's storage should be reused first" };
+        pool.destroy(p2);
+
+        co_yield "allocate and deallocate from 4 threads at once";
+        object_pool<std::uint64_t> shared;
+        std::atomic<bool> intact = true;
+        std::vector<std::thread> threads;
+        for (std::uint64_t id = 1; id <= 4; ++id)
+        {
+            threads.emplace_back([&, id] {
+                std::vector<std::uint64_t*> held;
+                for (int round = 0; round < 200; ++round)
+                {
+                    for (int i = 0; i < 100; ++i) { held.push_back(shared.create(id)); }
+                    for (auto* p : held) { intact = intact && *p == id; shared.destroy(p); }
+                    held.clear();
+                }
+            });
+        }
+        for (auto& t : threads) { t.join(); }
+        co_yield{ intact, "a block should never be handed out to two owners at once" };
+        co_yield{ shared.capacity() <= 400, std::format("freed blocks should be reused, but `{}` blocks have been carved for at most `400` live ones", shared.capacity()) };
+    }
+    co_yield{ ap.current_allocations == 0, std::format("destroying the pools should give back all slabs, but alloc_proxy's current_allocations is `{}`", ap.current_allocations) };
+    co_yield nullptr;
+
+    co_yield "use pool_allocator in std::list and std::allocate_shared";
+    {
+        std::list<int, pool_allocator<int>> l;
+        for (int i = 0; i < 1000; ++i) { l.push_back(i); }
+        co_yield{ l.back() == 999, "std::list with pool_allocator should work" };
+        co_yield{ ap.current_allocations == 1000, std::format("each node should be counted, but alloc_proxy's current_allocations is `{}`", ap.current_allocations) };
+        auto sp = std::allocate_shared<int_wrapper>(pool_allocator<int_wrapper>(), 42);
+        co_yield{ *sp == 42, "std::allocate_shared with pool_allocator should work" };
+    }
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    co_yield nullptr;
+
+    co_yield "use pool_allocator in my::allocate_shared and a self-referential container";
+    {
+        auto sp = my::allocate_shared<int>(pool_allocator<int>(), 3);
+        co_yield{ *sp == 3 && sp.use_count() == 1, "my::allocate_shared with pool_allocator should work" };
+        auto lp = my::allocate_local_shared<int>(pool_allocator<int>(), 4);
+        co_yield{ *lp == 4, "my::allocate_local_shared with pool_allocator should work" };
+        pool_node root;
+        root.kids.resize(3);
+        root.kids[1].kids.resize(2);
+        co_yield{ root.kids.size() == 3 && root.kids[1].kids.size() == 2, "a container whose element type holds the container itself should work with pool_allocator" };
+    }
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    ap.reset();
+#endif
+    co_return;
+}
+
+struct throw_on_fifth_copy
+{
+    static inline int copies = 0;
+    static inline int alive = 0;
+    throw_on_fifth_copy() { ++alive; }
+    throw_on_fifth_copy(const throw_on_fifth_copy&) { if (++copies == 5) { throw 5; } ++alive; }
+    ~throw_on_fifth_copy() { --alive; }
+};
+
+case_t uninitialized()
+{
+#ifndef USE_STD
+    co_yield{ is_trivially_relocatable_v<int> && is_trivially_relocatable_v<std::unique_ptr<int>> && is_trivially_relocatable_v<std::shared_ptr<int_wrapper>>, "ints and smart pointers should be trivially relocatable" };
+    co_yield{ !is_trivially_relocatable_v<int_wrapper> && !is_trivially_relocatable_v<std::vector<int>>, "types with user-provided move constructors should not be trivially relocatable by default" };
+
+    ap.reset_uncheck();
+    auto c = int_wrapper::counter_scope();
+    {
+        co_yield "relocate unique_ptrs into a larger buffer";
+        using Alloc = allocator<std::unique_ptr<int_wrapper>>;
+        Alloc alloc;
+        auto* old_buffer = allocator_traits<Alloc>::allocate(alloc, 100);
+        for (int i = 0; i < 100; ++i) { allocator_traits<Alloc>::construct(alloc, old_buffer + i, std::make_unique<int_wrapper>(i)); }
+        auto* new_buffer = allocator_traits<Alloc>::allocate(alloc, 200);
+        auto* end = uninitialized_relocate(alloc, old_buffer, old_buffer + 100, new_buffer);
+        allocator_traits<Alloc>::deallocate(alloc, old_buffer, 100);
+        co_yield{ end == new_buffer + 100 && *new_buffer[99] == 99, "relocated unique_ptrs should own the same objects" };
+        co_yield{ int_wrapper::move_count == 0 && int_wrapper::current_object_count == 100, "relocating unique_ptrs should not touch the owned objects" };
+        for (auto* p = new_buffer; p != end; ++p) { allocator_traits<Alloc>::destroy(alloc, p); }
+        allocator_traits<Alloc>::deallocate(alloc, new_buffer, 200);
+        co_yield{ int_wrapper::current_object_count == 0, "all objects should be destroyed exactly once" };
+        co_yield nullptr;
+
+        co_yield "relocate, move and copy int_wrappers";
+        allocator<int_wrapper> walloc;
+        int_wrapper* src = walloc.allocate(10);
+        int_wrapper* dst = walloc.allocate(10);
+        for (int i = 0; i < 10; ++i) { allocator_traits<allocator<int_wrapper>>::construct(walloc, src + i, i); }
+        int_wrapper::move_count = 0;
+        uninitialized_relocate(walloc, src, src + 10, dst);
+        co_yield{ int_wrapper::move_count == 10 && int_wrapper::current_object_count == 10 && dst[9] == 9, "int_wrappers should be relocated by move construction and destruction" };
+        auto* same = uninitialized_relocate(walloc, dst, dst + 10, dst);
+        co_yield{ same == dst + 10 && int_wrapper::move_count == 10 && int_wrapper::current_object_count == 10 && dst[9] == 9, "relocating a range onto itself should leave the elements untouched" };
+        uninitialized_copy(walloc, dst, dst + 10, src);
+        co_yield{ int_wrapper::copy_count == 10 && int_wrapper::current_object_count == 20 && src[9] == 9, "uninitialized_copy should copy construct" };
+        std::destroy(src, src + 10);
+        uninitialized_move(walloc, dst, dst + 10, src);
+        co_yield{ int_wrapper::move_count == 20 && src[9] == 9, "uninitialized_move should move construct" };
+        std::destroy(src, src + 10);
+        std::destroy(dst, dst + 10);
+        walloc.deallocate(src, 10);
+        walloc.deallocate(dst, 10);
+        co_yield nullptr;
+
+        co_yield "compact an int buffer in place";
+        std::vector<int> v(10);
+        for (int i = 0; i < 10; ++i) { v[i] = i; }
+        allocator<int> ialloc;
+        int* e = uninitialized_relocate(ialloc, v.data() + 3, v.data() + 10, v.data());
+        co_yield{ e == v.data() + 7 && v[0] == 3 && v[6] == 9, "overlapping relocation towards the front should keep the order" };
+        co_yield nullptr;
+
+        co_yield "copy into uninitialized memory with a throwing copy constructor";
+        allocator<throw_on_fifth_copy> talloc;
+        std::vector<throw_on_fifth_copy> from(10);
+        throw_on_fifth_copy* to = talloc.allocate(10);
+        bool thrown = false;
+        try { uninitialized_copy(talloc, from.begin(), from.end(), to); } catch (int) { thrown = true; }
+        co_yield{ thrown && throw_on_fifth_copy::alive == 10, std::format("copied elements should be destroyed when a copy throws, but `{}` objects are alive", throw_on_fifth_copy::alive) };
+        talloc.deallocate(to, 10);
+    }
+    co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    ap.reset();
+#endif
+    co_return;
+}
+
+case_t in_place_expand()
+{
+#ifndef USE_STD
+    ap.reset_uncheck();
+    {
+        co_yield "expand small blocks within their size class";
+        using Alloc = allocator<int>;
+        using T = allocator_traits<Alloc>;
+        Alloc alloc;
+        int* p = T::allocate(alloc, 5);
+        co_yield{ T::try_expand(alloc, p, 5, 8), "20 bytes should expand in place to 32 bytes, the size of their class" };
+        co_yield{ ap.current_allocated_bytes == 8 * sizeof(int) && ap.current_allocations == 1, std::format("alloc_proxy should record `{}` bytes in `1` allocation, but it actually records `{}` bytes in `{}`", 8 * sizeof(int), ap.current_allocated_bytes, ap.current_allocations) };
+        co_yield{ !T::try_expand(alloc, p, 8, 9), "32 bytes should not expand in place to 36 bytes" };
+        co_yield{ !T::try_expand(alloc, p, 8, 4), "try_expand should not shrink" };
+        T::deallocate(alloc, p, 8);
+        co_yield nullptr;
+
+        co_yield "expand large blocks within and past their pages";
+        allocator<char> calloc;
+        const size_t n = 300 * 1024 + 1;
+        char* q = calloc.allocate(n);
+        // 映射按页取整，末页尚余约 3 KiB。
+        co_yield{ calloc.try_expand(q, n, n + 1000), "a mapped block should expand in place within its last page" };
+        q[0] = 'a';
+        q[n + 999] = 'z';
+        size_t size = n + 1000;
+        // 能否越过末页取决于之后的地址空间，失败时块应保持原样。
+        if (calloc.try_expand(q, size, size + 1024 * 1024))
+        {
+            size += 1024 * 1024;
+            q[size - 1] = 'x';
+        }
+        co_yield{ q[0] == 'a' && q[n + 999] == 'z', "expanding should keep the contents" };
+        calloc.deallocate(q, size);
+        co_yield{ ap.current_allocated_bytes == 0 && ap.current_allocations == 0, "all blocks should be returned" };
+        co_yield nullptr;
+
+#if defined(YAN_ALLOC_HAS_MREMAP) && defined(MAP_FIXED_NOREPLACE)
+        co_yield "move a large block whose next page is taken";
+        const size_t old_size = 300 * 1024, new_size = 4 * old_size;
+        char* block = calloc.allocate(old_size);
+        for (size_t i = 0; i < old_size; i += 4096) { block[i] = static_cast<char>(i / 4096); }
+        char* end = block + _large_pages::mapped_size(old_size);
+        void* guard = ::mmap(end, 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        char* moved = calloc.reallocate(block, old_size, new_size);
+        bool kept = true;
+        for (size_t i = 0; i < old_size; i += 4096) { kept = kept && moved[i] == static_cast<char>(i / 4096); }
+        moved[new_size - 1] = 'x';
+        co_yield{ guard != end || moved != block, "the block should move when the page after it is taken" };
+        co_yield{ kept, "moving a large block should keep its contents" };
+        calloc.deallocate(moved, new_size);
+        if (guard != MAP_FAILED) { ::munmap(guard, 4096); }
+        co_yield{ ap.current_allocated_bytes == 0 && ap.current_allocations == 0, "all blocks should be returned" };
+        co_yield nullptr;
+#endif
+
+        co_yield "allocators without try_expand";
+        std::allocator<int> salloc;
+        int* r = salloc.allocate(5);
+        co_yield{ !allocator_traits<std::allocator<int>>::try_expand(salloc, r, 5, 6), "my::allocator_traits' DEFAULT try_expand should fail" };
+        salloc.deallocate(r, 5);
+        co_yield nullptr;
+
+        co_yield "reallocate a growing buffer";
+        allocator<int_wrapper> walloc;
+        auto c = int_wrapper::counter_scope();
+        int_wrapper* buffer = nullptr;
+        size_t capacity = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            if (i == static_cast<int>(capacity))
+            {
+                const size_t new_capacity = capacity == 0 ? 1 : capacity + capacity / 2 + 1;
+                buffer = reallocate(walloc, buffer, capacity, capacity, new_capacity);
+                capacity = new_capacity;
+            }
+            allocator_traits<decltype(walloc)>::construct(walloc, buffer + i, i);
+        }
+        bool intact = true;
+        for (int i = 0; i < 100; ++i) { intact = intact && buffer[i] == i; }
+        co_yield{ intact && int_wrapper::current_object_count == 100, "reallocate should keep every element exactly once" };
+        for (int i = 0; i < 100; ++i) { allocator_traits<decltype(walloc)>::destroy(walloc, buffer + i); }
+        walloc.deallocate(buffer, capacity);
+        co_yield nullptr;
+
+        co_yield "reallocate a large buffer of ints";
+        allocator<int> ialloc;
+        size_t count = 100000;
+        int* ints = ialloc.allocate(count);
+        for (size_t i = 0; i < count; ++i) { ints[i] = static_cast<int>(i); }
+        for (size_t i = 0; i < 3; ++i)
+        {
+            ints = reallocate(ialloc, ints, count, count, count * 2);
+            for (size_t j = count; j < count * 2; ++j) { ints[j] = static_cast<int>(j); }
+            count *= 2;
+        }
+        intact = true;
+        for (size_t i = 0; i < count; ++i) { intact = intact && ints[i] == static_cast<int>(i); }
+        co_yield{ intact, "reallocate should keep the contents of large blocks" };
+        co_yield{ ap.current_allocated_bytes == count * sizeof(int) && ap.current_allocations == 1, std::format("alloc_proxy should record `{}` bytes in `1` allocation, but it actually records `{}` bytes in `{}`", count * sizeof(int), ap.current_allocated_bytes, ap.current_allocations) };
+        ialloc.deallocate(ints, count);
+        co_yield{ ap.current_allocations == 0, std::format("alloc_proxy's current_allocations should be `0`, but it actually is `{}`", ap.current_allocations) };
+    }
+#endif
+    co_return;
+}
+
 case_t allocator_traits_types()
 {
     using T = NAMESPACE_MY allocator_traits<std::allocator<int>>;
@@ -414,6 +1278,31 @@ case_t alloc_at_least()
         co_yield nullptr;
     }
 
+    using S = my::allocator_traits<my::allocator<int, my::size_class_rounding>>;
+    my::allocator<int, my::size_class_rounding> sc_alloc;
+    auto size_class_should = [](size_t c) {
+        size_t bytes = c * sizeof(int);
+        size_t step = bytes <= 128 ? 16 : std::bit_floor(bytes - 1) / 4;
+        return (bytes + step - 1) / step * step / sizeof(int);
+    };
+    n = 1000;
+    while (n--)
+    {
+        size_t c = std::rand() % 32767 + 1;
+        co_yield std::format("my::allocator<int, size_class_rounding>::allocate_at_least({})", c);
+        auto [p4, size4] = n % 2 ? sc_alloc.allocate_at_least(c) : S::allocate_at_least(sc_alloc, c);
+        size_t should = size_class_should(c);
+        co_yield{ size4 == should, std::format("allocated size should be `{}`, but it actually is `{}`", should, size4) };
+        co_yield{ c <= 32 || (size4 - c) * 4 < c, std::format("size class rounding should waste less than 25%, but `{}` is rounded to `{}`", c, size4) };
+        co_yield{ ap.current_allocated_bytes == should * sizeof(int), std::format("alloc_proxy's current_allocated_bytes should be `{}`, but it actually is `{}`", should * sizeof(int), ap.current_allocated_bytes) };
+
+        co_yield "then deallocate it and reset alloc_proxy";
+        sc_alloc.deallocate(p4, size4);
+        ap.reset();
+        co_yield nullptr;
+    }
+    co_yield{ alloc == sc_alloc, "allocators with different rounding policies should be equal" };
+
     shit_allocator_2<int> sa2;
     co_yield std::format("my::allocator_traits' DEFAULT allocate_at_least(alloc, 10)");
 
@@ -433,11 +1322,23 @@ int main()
 {
     my::test::test t;
     t.new_case(my::test::alloc_proxy(), "alloc_proxy");
+    t.new_case(my::test::small_object_pool(), "small object pool");
+    t.new_case(my::test::sharded_stats(), "sharded statistics");
+    t.new_case(my::test::alloc_profile(), "allocation profiling");
+    t.new_case(my::test::alloc_trace(), "allocation tracing");
+    t.new_case(my::test::alloc_sample(), "allocation sampling");
     t.new_case(my::test::allocator_test(), "allocator");
     t.new_case(my::test::alloc_at_least(), "alloc_at_least");
+    t.new_case(my::test::over_aligned(), "over-aligned allocation");
+    t.new_case(my::test::accounting_policy(), "accounting policies");
     t.new_case(my::test::allocator_traits_types(), "member types of my::allocator_traits (by default)");
     t.new_case(my::test::our_traits_for_user_defined_allocator(), "member types of my::allocator_traits (user defined allocator)");
     t.new_case(my::test::allocator_with_std_traits(), "std::allocator_traits<my::allocator>");
     t.new_case(my::test::allocator_with_our_traits(), "my::allocator_traits<my::allocator>");
     t.new_case(my::test::shit_allocator_with_our_traits(), "my::allocator_traits<user_defined_allocator>");
+    t.new_case(my::test::arena(), "arena_allocator");
+    t.new_case(my::test::polymorphic(), "polymorphic_allocator");
+    t.new_case(my::test::object_pool_test(), "object_pool and pool_allocator");
+    t.new_case(my::test::uninitialized(), "uninitialized copy, move and relocate");
+    t.new_case(my::test::in_place_expand(), "in-place expansion");
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #include "co_yantest.hpp"
 #include "int_wrapper.hpp"
 #include "yan_memory.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
 #include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
 
 //#define USE_STD
 
@@ -176,6 +182,57 @@ case_t unique_ptr() {
     co_yield{ deleter_called, std::format("Custom deleter should be called on destruction, but it seems not.") };
 
     co_yield nullptr;
+
+    // 无状态的删除器不占空间；有状态的删除器照常存放。
+    co_yield "Checking the size of unique_ptr with stateless and stateful deleters...";
+    {
+        static int stateless_deletions = 0;
+        auto stateless_deleter = [](int* ptr) { delete ptr; ++stateless_deletions; };
+        static_assert(sizeof(NAMESPACE_MY unique_ptr<int_wrapper>) == sizeof(int_wrapper*));
+        static_assert(sizeof(NAMESPACE_MY unique_ptr<int[]>) == sizeof(int*));
+        static_assert(sizeof(NAMESPACE_MY unique_ptr<int, decltype(stateless_deleter)>) == sizeof(int*));
+        static_assert(sizeof(NAMESPACE_MY unique_ptr<int, decltype(custom_deleter)>) > sizeof(int*));
+        static_assert(sizeof(NAMESPACE_MY unique_ptr<int, void (*)(int*)>) == 2 * sizeof(int*));
+        {
+            NAMESPACE_MY unique_ptr<int, decltype(stateless_deleter)> p11(new int(1), stateless_deleter);
+            NAMESPACE_MY unique_ptr<int, decltype(stateless_deleter)> p12(std::move(p11));
+            p12.reset(new int(2));
+        }
+        co_yield{ stateless_deletions == 2,
+            std::format("The stateless deleter should be called twice, but was called `{}` time(s).", stateless_deletions) };
+    }
+    co_yield nullptr;
+
+    // 删除器为引用时 unique_ptr 只保存引用，且不能绑定到临时对象。
+    co_yield "Create unique_ptrs holding their deleter by reference...";
+    {
+        struct counting_deleter {
+            int calls = 0;
+            void operator()(int* ptr) { delete ptr; ++calls; }
+        };
+        using ref_ptr = NAMESPACE_MY unique_ptr<int, counting_deleter&>;
+        using cref_ptr = NAMESPACE_MY unique_ptr<int, const std::default_delete<int>&>;
+        static_assert(std::is_constructible_v<ref_ptr, int*, counting_deleter&>);
+        static_assert(!std::is_constructible_v<ref_ptr, int*, counting_deleter&&>);
+        static_assert(!std::is_constructible_v<ref_ptr, int*, const counting_deleter&>);
+        static_assert(std::is_constructible_v<cref_ptr, int*, const std::default_delete<int>&>);
+        static_assert(!std::is_constructible_v<cref_ptr, int*, std::default_delete<int>&&>);
+        static_assert(sizeof(ref_ptr) == 2 * sizeof(int*));
+        counting_deleter d;
+        {
+            ref_ptr p13(new int(13), d);
+            ref_ptr p14(std::move(p13));
+            p14.reset(new int(14));
+            co_yield{ &p14.get_deleter() == &d, "A reference deleter should refer to the original deleter." };
+        }
+        const std::default_delete<int> cd;
+        {
+            cref_ptr p15(new int(15), cd);
+            co_yield{ &p15.get_deleter() == &cd && *p15 == 15, "A const reference deleter should refer to the original deleter." };
+        }
+        co_yield{ d.calls == 2, std::format("The referenced deleter should be called twice, but was called `{}` time(s).", d.calls) };
+    }
+    co_yield nullptr;
 #endif
     co_return;
 }
@@ -349,6 +406,77 @@ case_t shared_ptr() {
         std::format("`Custom deleter` should be called upon `shared_ptr` destruction.") };
 
     co_yield nullptr;
+
+    // T 为数组时以 delete[] 删除，且只接受元素类型相同的指针。
+    co_yield "Create a `shared_ptr<int[]>` from `new int[3]` and a `shared_ptr<int_wrapper[]>` with a deleter.";
+    {
+        struct Base {};
+        struct Derived : Base {};
+        static_assert(std::is_constructible_v<NAMESPACE_MY shared_ptr<const int[]>, int*>);
+        static_assert(!std::is_constructible_v<NAMESPACE_MY shared_ptr<Base[]>, Derived*>);
+        static_assert(!std::is_constructible_v<NAMESPACE_MY shared_ptr<int>, NAMESPACE_MY unique_ptr<int[]>&&>);
+        static_assert(!std::is_constructible_v<NAMESPACE_MY shared_ptr<int[]>, NAMESPACE_MY unique_ptr<int>&&>);
+
+        NAMESPACE_MY shared_ptr<int[]> p13(new int[3] {1, 2, 3});
+        co_yield{ p13[0] == 1 && p13[1] == 2 && p13[2] == 3,
+            std::format("`operator[]` should return `[1,2,3]` in a series, but we get `[{},{},{}]`.", p13[0], p13[1], p13[2]) };
+        {
+            NAMESPACE_MY shared_ptr<int_wrapper[]> p14(new int_wrapper[3]);
+            co_yield{ int_wrapper::current_object_count == 3 && static_cast<int>(p14[2]) == 0,
+                std::format("`p14` should hold `3` objects, but `{}` are alive.", int_wrapper::current_object_count) };
+        }
+        co_yield{ int_wrapper::current_object_count == 0,
+            std::format("`shared_ptr<int_wrapper[]>` should delete all `3` objects, but `{}` are left.", int_wrapper::current_object_count) };
+
+        bool array_deleted = false;
+        {
+            NAMESPACE_MY shared_ptr<int[]> p15(new int[2] {5, 6}, [&](int* ptr) { delete[] ptr; array_deleted = true; });
+            co_yield{ p15[1] == 6, std::format("`p15[1]` should be `6`, but got `{}`.", p15[1]) };
+        }
+        co_yield{ array_deleted, "The deleter of `p15` should be called." };
+    }
+    co_yield nullptr;
+
+    co_yield "Create a `shared_ptr` owning `nullptr` with a deleter.";
+    {
+        bool null_deleted = false;
+        {
+            NAMESPACE_MY shared_ptr<int> p16(nullptr, [&](int* ptr) { null_deleted = ptr == nullptr; });
+            co_yield{ !p16 && p16.use_count() == 1,
+                std::format("`p16` should be empty with `use_count` `1`, but `use_count` is `{}`.", p16.use_count()) };
+        }
+        co_yield{ null_deleted, "The deleter should be called with `nullptr`." };
+    }
+    co_yield nullptr;
+
+    co_yield "Move `unique_ptr`s into `shared_ptr`s.";
+    {
+        NAMESPACE_MY unique_ptr<int_wrapper> u1(new int_wrapper(17));
+        NAMESPACE_MY shared_ptr<int_wrapper> p17(std::move(u1));
+        co_yield{ !u1 && p17 && *p17 == int_wrapper(17) && p17.use_count() == 1,
+            std::format("`p17` should take over `17` from the `unique_ptr` with `use_count` `1`, but `use_count` is `{}`.", p17.use_count()) };
+
+        NAMESPACE_MY unique_ptr<int_wrapper[]> u2(new int_wrapper[2]);
+        NAMESPACE_MY shared_ptr<int_wrapper[]> p18;
+        p18 = std::move(u2);
+        co_yield{ !u2 && p18 && int_wrapper::current_object_count == 3,
+            std::format("`p18` should take over `2` objects, but `{}` objects are alive in total.", int_wrapper::current_object_count) };
+
+        int deletions = 0;
+        auto counting_deleter = [&](int* ptr) { delete ptr; ++deletions; };
+        NAMESPACE_MY unique_ptr<int, decltype(counting_deleter)&> u3(new int(18), counting_deleter);
+        NAMESPACE_MY shared_ptr<int> p19(std::move(u3));
+        p19.reset();
+        co_yield{ deletions == 1, std::format("The referenced deleter should be called once, but was called `{}` time(s).", deletions) };
+
+        NAMESPACE_MY unique_ptr<int> u4;
+        NAMESPACE_MY shared_ptr<int> p20(std::move(u4));
+        co_yield{ !p20 && p20.use_count() == 0,
+            std::format("An empty `unique_ptr` should give an empty `shared_ptr`, but `use_count` is `{}`.", p20.use_count()) };
+    }
+    co_yield{ int_wrapper::current_object_count == 0,
+        std::format("Resource leak detected: `int_wrapper::current_object_count` is `{}`, expected `0`.", int_wrapper::current_object_count) };
+    co_yield nullptr;
 #endif
     co_return;
 }
@@ -715,6 +843,577 @@ case_t type_casting() {
 #endif
     co_return;
 }
+case_t local_shared_ptr() {
+#if defined(DISMISS_SHARED_AND_WEAK_PTR) || defined(USE_STD)
+    co_yield { case_t::state::DISMISSED, "test for `local_shared_ptr` has been dismissed." };
+#else
+    co_yield "Create a local_shared_ptr `p1` by make_local_shared with int_wrapper(7).";
+    {
+        auto p1 = my::make_local_shared<int_wrapper>(7);
+        co_yield{ p1 && *p1 == int_wrapper(7),
+            std::format("`p1` should hold `int_wrapper(7)`, but got `{}`.", p1 ? (int)(*p1) : -1) };
+        co_yield{ p1.use_count() == 1,
+            std::format("`p1.use_count()` should be `1`, but got `{}`.", p1.use_count()) };
+
+        co_yield "Copy `p1` into `p2` and `p3`, then move `p3` into `p4`.";
+        my::local_shared_ptr<int_wrapper> p2(p1);
+        my::local_shared_ptr<int_wrapper> p3 = p2;
+        my::local_shared_ptr<int_wrapper> p4(std::move(p3));
+        co_yield{ !p3 && p1.use_count() == 3 && p4.use_count() == 3,
+            std::format("`use_count` should be `3` with `p3` empty, but got `{}` and `p3` is {}.", p1.use_count(), p3 ? "not empty" : "empty") };
+
+        co_yield "Reset `p2` and `p4`.";
+        p2.reset();
+        p4.reset();
+        co_yield{ p1.use_count() == 1 && int_wrapper::current_object_count == 1,
+            std::format("`p1.use_count()` should be `1` with 1 object alive, but got `{}` with `{}` object(s).", p1.use_count(), int_wrapper::current_object_count) };
+    }
+    co_yield{ int_wrapper::current_object_count == 0,
+        std::format("Resource leak detected: `int_wrapper::current_object_count` is `{}`, expected `0`.", int_wrapper::current_object_count) };
+    co_yield nullptr;
+
+    co_yield "Create a local_shared_ptr by allocate_local_shared with a custom allocator.";
+    {
+        int alloc_counter = 0;
+        {
+            auto p = my::allocate_local_shared<int_wrapper>(custom_allocator<int_wrapper>(&alloc_counter), 5);
+            auto q = p;
+            co_yield{ alloc_counter == 1 && q.use_count() == 2,
+                std::format("There should be 1 allocation and `use_count` 2, but got `{}` and `{}`.", alloc_counter, q.use_count()) };
+        }
+        co_yield{ alloc_counter == 0,
+            std::format("Allocator should deallocate the block, but `{}` block(s) still alive.", alloc_counter) };
+    }
+    co_yield nullptr;
+
+    bool deleter_called = false;
+    {
+        my::local_shared_ptr<int> p(new int(99), [&](int* ptr) { delete ptr; deleter_called = true; });
+        auto q = p;
+    }
+    co_yield{ deleter_called,
+        std::format("`Custom deleter` should be called upon `local_shared_ptr` destruction.") };
+    co_yield nullptr;
+#endif
+    co_return;
+}
+case_t shared_ptr_threads() {
+#if defined(DISMISS_SHARED_AND_WEAK_PTR) || defined(USE_STD)
+    co_yield { case_t::state::DISMISSED, "test for `shared_ptr` across threads has been dismissed." };
+#else
+    co_yield "Copy and destroy a biased shared_ptr created on this thread from 8 threads.";
+    {
+        my::biased_shared_scope biased;
+        auto p = my::make_shared<int_wrapper>(1);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 8; ++t) {
+            workers.emplace_back([&p] {
+                std::vector<my::shared_ptr<int_wrapper>> copies(16);
+                for (int i = 0; i < 100000; ++i) {
+                    copies[i % 16] = p;
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        co_yield{ p.use_count() == 1 && int_wrapper::current_object_count == 1,
+            std::format("`p.use_count()` should be `1` with 1 object alive, but got `{}` with `{}` object(s).", p.use_count(), int_wrapper::current_object_count) };
+    }
+    co_yield{ int_wrapper::current_object_count == 0,
+        std::format("Resource leak detected: `int_wrapper::current_object_count` is `{}`, expected `0`.", int_wrapper::current_object_count) };
+    co_yield nullptr;
+
+    co_yield "Hand a copy of a biased shared_ptr to another thread that releases it, then release the original here.";
+    {
+        my::biased_shared_scope biased;
+        auto p = my::make_shared<int_wrapper>(2);
+        auto q = p;
+        std::thread([q = std::move(q)]() mutable { q.reset(); }).join();
+        co_yield{ p.use_count() == 1,
+            std::format("`p.use_count()` should be `1`, but got `{}`.", p.use_count()) };
+        p.reset();
+        co_yield{ int_wrapper::current_object_count == 0,
+            std::format("The object should be destroyed once the last reference is released, but `{}` object(s) alive.", int_wrapper::current_object_count) };
+    }
+    co_yield nullptr;
+
+    co_yield "Create an object on a thread that exits, and release the last reference on another.";
+    {
+        my::shared_ptr<int_wrapper> slot;
+        my::weak_ptr<int_wrapper> watch;
+        std::thread([&] {
+            my::biased_shared_scope biased;
+            slot = my::make_shared<int_wrapper>(3);
+            watch = slot;
+        }).join();
+        std::thread([&] {
+            auto copy = watch.lock();
+            slot.reset();
+        }).join();
+        co_yield{ watch.expired() && int_wrapper::current_object_count == 0,
+            std::format("The object should be destroyed, but `watch.expired()` is `{}` with `{}` object(s) alive.", watch.expired(), int_wrapper::current_object_count) };
+    }
+    co_yield nullptr;
+
+    // 不在 biased_shared_scope 内时，最后一个引用在哪个线程释放，对象就在哪里析构。
+    co_yield "Release the original first, then drop the last copy on another thread.";
+    {
+        my::weak_ptr<int_wrapper> watch;
+        {
+            auto p = my::make_shared<int_wrapper>(4);
+            watch = p;
+            auto q = p;
+            p.reset();
+            std::thread([q = std::move(q)]() mutable { q.reset(); }).join();
+        }
+        const bool expired = watch.expired();
+        const int alive = int_wrapper::current_object_count;
+        co_yield{ expired && alive == 0,
+            std::format("The object should be destroyed on the other thread, but `watch.expired()` is `{}` with `{}` object(s) alive.", expired, alive) };
+    }
+    co_yield nullptr;
+
+    // 偏向计数下析构推迟到所有者离开作用域，其间 expired、use_count 与 lock 的结果一致。
+    co_yield "Do the same with a biased shared_ptr, then leave the biased scope.";
+    {
+        my::weak_ptr<int_wrapper> watch;
+        std::optional<my::biased_shared_scope> biased(std::in_place);
+        {
+            auto p = my::make_shared<int_wrapper>(5);
+            watch = p;
+            auto q = p;
+            p.reset();
+            std::thread([q = std::move(q)]() mutable { q.reset(); }).join();
+        }
+        // 在其他线程 lock，所有者线程上的 lock 本身就会处理合并队列。
+        bool locked = false;
+        std::thread([&] { locked = watch.lock() != nullptr; }).join();
+        const bool expired = watch.expired();
+        const long count = watch.use_count();
+        const int pending = int_wrapper::current_object_count;
+        co_yield{ !expired && count == 1 && locked && pending == 1,
+            std::format("Before the owner merges, `expired()`, `use_count()` and `lock()` should agree the object is alive, but got `{}`, `{}` and `{}` with `{}` object(s).", expired, count, locked, pending) };
+        biased.reset();
+        const int alive = int_wrapper::current_object_count;
+        co_yield{ watch.expired() && alive == 0,
+            std::format("Leaving the scope should destroy the object, but `{}` object(s) alive.", alive) };
+    }
+    co_yield nullptr;
+
+    constexpr int rounds = 2000000;
+    auto copy_and_destroy = [](auto p, int n) {
+        std::vector<decltype(p)> copies(16);
+        const auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) {
+            copies[i % 16] = p;
+            copies[(i + 8) % 16].reset();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / n;
+    };
+    const double plain = copy_and_destroy(my::make_shared<int>(0), rounds);
+    double owner = 0;
+    {
+        my::biased_shared_scope biased;
+        owner = copy_and_destroy(my::make_shared<int>(0), rounds);
+    }
+    const double baseline = copy_and_destroy(std::make_shared<int>(0), rounds);
+    double others = 0;
+    {
+        auto p = my::make_shared<int>(0);
+        std::vector<std::thread> workers;
+        std::vector<double> times(4);
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&, t] { times[t] = copy_and_destroy(p, rounds / 4); });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        for (double time : times) {
+            others += time / 4;
+        }
+    }
+    // 基准结果不作为检查条件，直接输出。
+    std::cerr << std::format("\n    copy and destroy: {:.2f} ns unbiased, {:.2f} ns on the owner thread, {:.2f} ns for std::shared_ptr, {:.2f} ns on 4 other threads at once\n", plain, owner, baseline, others);
+#endif
+    co_return;
+}
+case_t atomic_shared_ptr() {
+#ifdef DISMISS_SHARED_AND_WEAK_PTR
+    co_yield { case_t::state::DISMISSED, "test for `atomic<shared_ptr>` has been dismissed." };
+#else
+    co_yield "Store, load and exchange through atomic<shared_ptr<int_wrapper>>.";
+    {
+        NAMESPACE_MY atomic<NAMESPACE_MY shared_ptr<int_wrapper>> a;
+        co_yield{ !a.load(), "A default constructed atomic<shared_ptr> should hold an empty pointer." };
+
+        auto p1 = NAMESPACE_MY make_shared<int_wrapper>(1);
+        a.store(p1);
+        auto loaded = a.load();
+        co_yield{ loaded == p1 && p1.use_count() == 3,
+            std::format("`load()` should return `p1` and share its ownership, but `use_count()` is `{}`.", p1.use_count()) };
+
+        auto p2 = NAMESPACE_MY make_shared<int_wrapper>(2);
+        auto old = a.exchange(p2);
+        co_yield{ old == p1 && a.load() == p2,
+            "`exchange()` should return the previous value and store the new one." };
+
+        co_yield "compare_exchange_strong with a stale and then a current expected value.";
+        auto expected = p1;
+        bool swapped = a.compare_exchange_strong(expected, p1);
+        co_yield{ !swapped && expected == p2,
+            "`compare_exchange_strong()` should fail and load the current value into `expected`." };
+        swapped = a.compare_exchange_strong(expected, p1);
+        co_yield{ swapped && a.load() == p1,
+            "`compare_exchange_strong()` should succeed when `expected` is current." };
+
+        a.store(nullptr);
+        loaded.reset();
+        old.reset();
+        co_yield{ p1.use_count() == 1 && p2.use_count() == 2,
+            std::format("Only the local copies should remain, but `use_count()` is `{}` and `{}`.", p1.use_count(), p2.use_count()) };
+
+        NAMESPACE_MY atomic<NAMESPACE_MY weak_ptr<int_wrapper>> w;
+        w.store(p2);
+        co_yield{ w.load().lock() == p2, "atomic<weak_ptr> should load a weak_ptr that locks to `p2`." };
+    }
+    co_yield nullptr;
+
+    // 旧快照可能在读取线程上析构，int_wrapper 的计数不是线程安全的，这里改用 int。
+    co_yield "Publish 10000 snapshots while 4 threads load them.";
+    {
+        NAMESPACE_MY atomic<NAMESPACE_MY shared_ptr<int>> a(NAMESPACE_MY make_shared<int>(0));
+        std::atomic<bool> stop = false;
+        std::atomic<int> regressions = 0;
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&] {
+                int last = 0;
+                while (!stop.load()) {
+                    auto p = a.load();
+                    if (!p || *p < last) {
+                        ++regressions;
+                    }
+                    last = p ? *p : last;
+                }
+            });
+        }
+        for (int i = 1; i <= 10000; ++i) {
+            a.store(NAMESPACE_MY make_shared<int>(i));
+        }
+        stop = true;
+        for (auto& r : readers) {
+            r.join();
+        }
+        co_yield{ regressions == 0,
+            std::format("Readers should see non-empty, increasing snapshots, but saw `{}` regressions.", regressions.load()) };
+        co_yield{ *a.load() == 10000,
+            std::format("The last snapshot should be `10000`, but got `{}`.", *a.load()) };
+    }
+    co_yield nullptr;
+#endif
+    co_return;
+}
+case_t control_block() {
+#ifdef DISMISS_SHARED_AND_WEAK_PTR
+    co_yield { case_t::state::DISMISSED, "test for the control block has been dismissed." };
+#else
+#ifndef USE_STD
+    co_yield "Check the size of the control block.";
+    // 函数表指针、强弱合一的计数、偏向计数、所有者与合并队列指针各占一个字。
+    co_yield{ sizeof(my::control_block_base) <= 5 * 8,
+        std::format("`control_block_base` should take at most 40 bytes, but takes `{}`.", sizeof(my::control_block_base)) };
+    co_yield nullptr;
+#endif
+
+    co_yield "Drop the last shared_ptr while a weak_ptr is alive, then drop the weak_ptr.";
+    {
+        int alloc_counter = 0;
+        auto p = NAMESPACE_MY allocate_shared<int_wrapper>(custom_allocator<int_wrapper>(&alloc_counter), 3);
+        NAMESPACE_MY weak_ptr<int_wrapper> w = p;
+        auto locked = w.lock();
+        co_yield{ locked == p && p.use_count() == 2,
+            std::format("`lock()` should share ownership with `p`, but `use_count()` is `{}`.", p.use_count()) };
+
+        locked.reset();
+        p.reset();
+        co_yield{ int_wrapper::current_object_count == 0 && alloc_counter == 1,
+            std::format("The object should be destroyed but the block kept, but got `{}` object(s) and `{}` block(s).", int_wrapper::current_object_count, alloc_counter) };
+        co_yield{ w.expired() && !w.lock(),
+            "The weak_ptr should be expired and `lock()` should return an empty pointer." };
+
+        w.reset();
+        co_yield{ alloc_counter == 0,
+            std::format("Allocator should deallocate the block, but `{}` block(s) still alive.", alloc_counter) };
+    }
+    co_yield nullptr;
+
+    co_yield "Lock a weak_ptr from 4 threads while the owner drops the last shared_ptr.";
+    {
+        std::atomic<int> destroyed = 0;
+        std::atomic<int> corrupted = 0;
+        int still_alive = 0;
+        for (int round = 0; round < 200; ++round) {
+            NAMESPACE_MY shared_ptr<int> p(new int(round), [&](int* ptr) { delete ptr; ++destroyed; });
+            NAMESPACE_MY weak_ptr<int> w = p;
+            std::vector<std::thread> workers;
+            for (int t = 0; t < 4; ++t) {
+                workers.emplace_back([&w, &corrupted, round] {
+                    for (int i = 0; i < 200; ++i) {
+                        if (auto q = w.lock(); q && *q != round) {
+                            ++corrupted;
+                        }
+                    }
+                });
+            }
+            p.reset();
+            // 工作线程可能仍持有 lock 得到的引用，等它们结束后对象才一定已析构。
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            still_alive += w.expired() ? 0 : 1;
+        }
+        co_yield{ destroyed == 200 && corrupted == 0 && still_alive == 0,
+            std::format("Every object should be destroyed exactly once, but got `{}` of 200 with `{}` bad lock(s) and `{}` unexpired.", destroyed.load(), corrupted.load(), still_alive) };
+    }
+    co_yield nullptr;
+#endif
+    co_return;
+}
+#ifndef USE_STD
+template <typename Policy>
+struct intrusive_node : my::intrusive_ref_counter<intrusive_node<Policy>, Policy> {
+    static inline std::atomic<int> alive = 0;
+    int value;
+
+    explicit intrusive_node(int value) : value(value) { ++alive; }
+    ~intrusive_node() { --alive; }
+};
+#endif
+case_t intrusive_ptr() {
+#ifdef USE_STD
+    co_yield { case_t::state::DISMISSED, "test for `intrusive_ptr` has been dismissed." };
+#else
+    using node = intrusive_node<my::thread_safe_counter>;
+    using local_node = intrusive_node<my::thread_unsafe_counter>;
+
+    co_yield "Create an intrusive_ptr `p1` by make_intrusive, then copy and move it.";
+    {
+        co_yield{ sizeof(my::intrusive_ptr<node>) == sizeof(node*),
+            std::format("`intrusive_ptr` should be as large as a raw pointer, but takes `{}` bytes.", sizeof(my::intrusive_ptr<node>)) };
+
+        auto p1 = my::make_intrusive<node>(7);
+        co_yield{ p1 && p1->value == 7 && p1->use_count() == 1,
+            std::format("`p1` should hold 7 with count 1, but the count is `{}`.", p1 ? p1->use_count() : 0) };
+
+        my::intrusive_ptr<node> p2 = p1;
+        my::intrusive_ptr<node> p3(std::move(p2));
+        co_yield{ !p2 && p3 == p1 && p1->use_count() == 2,
+            std::format("The count should be `2` with `p2` empty, but got `{}`.", p1->use_count()) };
+
+        co_yield "Detach `p3` and adopt the pointer again without adding a reference.";
+        node* raw = p3.detach();
+        my::intrusive_ptr<node> p4(raw, false);
+        co_yield{ !p3 && p4 == p1 && p1->use_count() == 2,
+            std::format("The count should stay `2` after detach and adopt, but got `{}`.", p1->use_count()) };
+
+        p4.reset();
+        co_yield{ p1->use_count() == 1 && node::alive == 1,
+            std::format("The count should be `1` with 1 object alive, but got `{}` with `{}` object(s).", p1->use_count(), node::alive.load()) };
+    }
+    co_yield{ node::alive == 0,
+        std::format("Resource leak detected: `{}` node(s) still alive.", node::alive.load()) };
+    co_yield nullptr;
+
+    co_yield "Transfer ownership from a unique_ptr to an intrusive_ptr.";
+    {
+        auto u = my::make_unique<local_node>(3);
+        my::intrusive_ptr<local_node> p(std::move(u));
+        co_yield{ !u && p && p->value == 3 && p->use_count() == 1,
+            std::format("`p` should take over the object with count 1, but the count is `{}`.", p ? p->use_count() : 0) };
+
+        my::intrusive_ptr<local_node> q;
+        q = my::make_unique<local_node>(4);
+        co_yield{ q && q->value == 4 && q->use_count() == 1 && local_node::alive == 2,
+            std::format("`q` should hold 4 with 2 objects alive, but got `{}` object(s).", local_node::alive.load()) };
+    }
+    co_yield{ local_node::alive == 0,
+        std::format("Resource leak detected: `{}` node(s) still alive.", local_node::alive.load()) };
+    co_yield nullptr;
+
+    co_yield "Copy and destroy an intrusive_ptr from 4 threads.";
+    {
+        auto p = my::make_intrusive<node>(1);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&p] {
+                std::vector<my::intrusive_ptr<node>> copies(16);
+                for (int i = 0; i < 100000; ++i) {
+                    copies[i % 16] = p;
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        co_yield{ p->use_count() == 1,
+            std::format("The count should be `1` after all threads finish, but got `{}`.", p->use_count()) };
+    }
+    co_yield{ node::alive == 0,
+        std::format("Resource leak detected: `{}` node(s) still alive.", node::alive.load()) };
+    co_yield nullptr;
+#endif
+    co_return;
+}
+struct throwing_element {
+    static inline int alive = 0;
+    static inline int throw_at = -1;
+
+    throwing_element() {
+        if (alive == throw_at) {
+            throw std::runtime_error("throwing_element");
+        }
+        ++alive;
+    }
+    ~throwing_element() { --alive; }
+};
+case_t make_shared_array() {
+#ifdef DISMISS_SHARED_AND_WEAK_PTR
+    co_yield { case_t::state::DISMISSED, "test for array `make_shared` has been dismissed." };
+#else
+    co_yield "Create a shared_ptr<int[]> by make_shared<int[]>(5) and a shared_ptr<int_wrapper[3]>.";
+    {
+        auto p = NAMESPACE_MY make_shared<int[]>(5);
+        bool zeroed = true;
+        for (int i = 0; i < 5; ++i) {
+            zeroed = zeroed && p[i] == 0;
+            p[i] = i;
+        }
+        co_yield{ zeroed && p[4] == 4 && p.use_count() == 1,
+            std::format("The elements should be value-initialized and writable, `use_count()` is `{}`.", p.use_count()) };
+
+        auto q = NAMESPACE_MY make_shared<int_wrapper[3]>();
+        co_yield{ int_wrapper::current_object_count == 3 && q[2] == 0,
+            std::format("There should be 3 objects alive, but got `{}`.", int_wrapper::current_object_count) };
+        q.reset();
+        co_yield{ int_wrapper::current_object_count == 0,
+            std::format("Resource leak detected: `int_wrapper::current_object_count` is `{}`, expected `0`.", int_wrapper::current_object_count) };
+    }
+    co_yield nullptr;
+
+    co_yield "Fill a two-dimensional array with make_shared<int[][2]>(3, {1, 2}).";
+    {
+        auto p = NAMESPACE_MY make_shared<int[][2]>(3, { 1, 2 });
+        bool filled = true;
+        for (int i = 0; i < 3; ++i) {
+            filled = filled && p[i][0] == 1 && p[i][1] == 2;
+        }
+        co_yield{ filled, "Every row should be a copy of `{1, 2}`." };
+
+        auto q = NAMESPACE_MY make_shared<int_wrapper[4]>(int_wrapper(9));
+        co_yield{ q[0] == 9 && q[3] == 9 && int_wrapper::current_object_count == 4,
+            std::format("Every element should be a copy of 9 with 4 objects alive, but got `{}` object(s).", int_wrapper::current_object_count) };
+    }
+    co_yield nullptr;
+
+    co_yield "Create an array by allocate_shared with a custom allocator.";
+    {
+        int alloc_counter = 0;
+        {
+            auto p = NAMESPACE_MY allocate_shared<int_wrapper[]>(custom_allocator<int_wrapper>(&alloc_counter), 100, int_wrapper(3));
+            co_yield{ alloc_counter == 1 && p[99] == 3 && int_wrapper::current_object_count == 100,
+                std::format("The elements and control block should share 1 allocation, but got `{}` allocation(s).", alloc_counter) };
+        }
+        co_yield{ alloc_counter == 0 && int_wrapper::current_object_count == 0,
+            std::format("Allocator should deallocate the block, but `{}` block(s) and `{}` object(s) still alive.", alloc_counter, int_wrapper::current_object_count) };
+
+        co_yield "Throw while constructing the third element.";
+        throwing_element::throw_at = 2;
+        bool thrown = false;
+        try {
+            auto p = NAMESPACE_MY allocate_shared<throwing_element[]>(custom_allocator<throwing_element>(&alloc_counter), 5);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        throwing_element::throw_at = -1;
+        co_yield{ thrown && throwing_element::alive == 0 && alloc_counter == 0,
+            std::format("Constructed elements and the block should be released, but got `{}` element(s) and `{}` block(s).", throwing_element::alive, alloc_counter) };
+    }
+    co_yield nullptr;
+
+    co_yield "Create default-initialized buffers with make_shared_for_overwrite and make_unique_for_overwrite.";
+    {
+        auto p = NAMESPACE_MY make_shared_for_overwrite<unsigned char[]>(4096);
+        p[4095] = 1;
+        auto q = NAMESPACE_MY make_shared_for_overwrite<int_wrapper>();
+        co_yield{ p[4095] == 1 && int_wrapper::current_object_count == 1 && *q == 0,
+            "`make_shared_for_overwrite` should still run default constructors of class types." };
+
+        auto u = NAMESPACE_MY make_unique_for_overwrite<double[]>(64);
+        u[63] = 1.5;
+        auto v = NAMESPACE_MY make_unique_for_overwrite<int>();
+        *v = 7;
+        co_yield{ u[63] == 1.5 && *v == 7, "Buffers from `make_unique_for_overwrite` should be writable." };
+    }
+    co_yield nullptr;
+#endif
+    co_return;
+}
+case_t allocate_unique() {
+#if defined(DISMISS_UNIQUE_PTR) || defined(USE_STD)
+    co_yield { case_t::state::DISMISSED, "test for `allocate_unique` has been dismissed." };
+#else
+    co_yield "Create a unique_ptr by allocate_unique with a custom allocator.";
+    {
+        int alloc_counter = 0;
+        {
+            auto p = my::allocate_unique<int_wrapper>(custom_allocator<int_wrapper>(&alloc_counter), 5);
+            co_yield{ p && *p == 5 && alloc_counter == 1 && int_wrapper::current_object_count == 1,
+                std::format("`p` should hold 5 in 1 allocation, but got `{}` allocation(s).", alloc_counter) };
+
+            auto q = std::move(p);
+            q.reset();
+            co_yield{ !p && alloc_counter == 0 && int_wrapper::current_object_count == 0,
+                std::format("`reset()` should destroy and deallocate, but `{}` block(s) and `{}` object(s) still alive.", alloc_counter, int_wrapper::current_object_count) };
+        }
+
+        // 空的分配器不占空间。
+        static_assert(sizeof(my::unique_ptr<int, my::allocator_delete<int, my::allocator<int>>>) == sizeof(int*));
+        auto r = my::allocate_unique<const int>(my::allocator<int>(), 42);
+        co_yield{ *r == 42, std::format("`r` should hold 42, but got `{}`.", *r) };
+    }
+    co_yield nullptr;
+
+    co_yield "Create an array by allocate_unique<int_wrapper[]>.";
+    {
+        int alloc_counter = 0;
+        {
+            auto p = my::allocate_unique<int_wrapper[]>(custom_allocator<int_wrapper>(&alloc_counter), 10);
+            p[9] = 9;
+            co_yield{ p[0] == 0 && p[9] == 9 && p.get_deleter().size() == 10 && int_wrapper::current_object_count == 10,
+                std::format("There should be 10 value-initialized objects, but got `{}`.", int_wrapper::current_object_count) };
+        }
+        co_yield{ alloc_counter == 0 && int_wrapper::current_object_count == 0,
+            std::format("Allocator should deallocate the array, but `{}` block(s) and `{}` object(s) still alive.", alloc_counter, int_wrapper::current_object_count) };
+
+        co_yield "Throw while constructing the third element.";
+        throwing_element::throw_at = 2;
+        bool thrown = false;
+        try {
+            auto p = my::allocate_unique<throwing_element[]>(custom_allocator<throwing_element>(&alloc_counter), 5);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        throwing_element::throw_at = -1;
+        co_yield{ thrown && throwing_element::alive == 0 && alloc_counter == 0,
+            std::format("Constructed elements and the storage should be released, but got `{}` element(s) and `{}` block(s).", throwing_element::alive, alloc_counter) };
+    }
+    co_yield nullptr;
+#endif
+    co_return;
+}
         
 
     } // namespace my::test
@@ -729,4 +1428,11 @@ int main()
     t.new_case(my::test::weak_ptr(), "weak_ptr");
     t.new_case(my::test::enable_shared_from_this(), "enable_shared_from_this");
     t.new_case(my::test::type_casting(), "type_casting");
+    t.new_case(my::test::local_shared_ptr(), "local_shared_ptr");
+    t.new_case(my::test::shared_ptr_threads(), "shared_ptr_threads");
+    t.new_case(my::test::atomic_shared_ptr(), "atomic_shared_ptr");
+    t.new_case(my::test::control_block(), "control_block");
+    t.new_case(my::test::intrusive_ptr(), "intrusive_ptr");
+    t.new_case(my::test::make_shared_array(), "make_shared_array");
+    t.new_case(my::test::allocate_unique(), "allocate_unique");
 }
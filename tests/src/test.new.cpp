@@ -0,0 +1,143 @@
+// 与 yanSTL/src/yan_new.cpp 一起编译：全局 operator new/delete 经由 _alloc_proxy 分配。
+#include "co_yantest.hpp"
+#include "yan_allocator.hpp"
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace my
+{
+    namespace test
+    {
+
+auto& ap = _alloc_proxy::get_instance();
+
+// 分配并写满 size 字节，回收后检查统计量是否复原。
+template <typename Allocate, typename Deallocate>
+bool round_trip(size_t size, Allocate allocate, Deallocate deallocate)
+{
+    const size_t bytes = ap.current_allocated_bytes, allocations = ap.current_allocations;
+    void* ptr = allocate(size);
+    if (ptr == nullptr)
+    {
+        return false;
+    }
+    std::memset(ptr, 0xab, size);
+    const bool counted = ap.current_allocations == allocations + 1 && ap.current_allocated_bytes >= bytes + size;
+    deallocate(ptr, size);
+    return counted && ap.current_allocations == allocations && ap.current_allocated_bytes == bytes;
+}
+
+case_t global_new()
+{
+    co_yield "new 8 bytes";
+    size_t before = ap.current_allocated_bytes;
+    void* small = ::operator new(8);
+    const size_t charged = ap.current_allocated_bytes - before;
+    const size_t pooled = _alloc_proxy::pooled_size_of(small);
+    ::operator delete(small);
+    const size_t after = ap.current_allocated_bytes;
+    co_yield{ charged == _alloc_proxy::pooled_size(8) && charged < 32, std::format("8 bytes should be charged as the `{}` bytes of its size class, but `{}` bytes are charged", _alloc_proxy::pooled_size(8), charged) };
+    co_yield{ pooled == charged, std::format("the block should be found in a slab of `{}` bytes, but pooled_size_of gives `{}`", charged, pooled) };
+    co_yield{ after == before, "unsized delete should give back exactly what new charged" };
+    co_yield nullptr;
+
+    co_yield "pair every form of operator new with its operator delete";
+    bool paired = true;
+    for (size_t size : { size_t(1), size_t(8), size_t(100), size_t(4000), size_t(32 * 1024), size_t(100000), size_t(2 * 1024 * 1024) })
+    {
+        paired = paired && round_trip(size, [](size_t n) { return ::operator new(n); }, [](void* p, size_t) { ::operator delete(p); });
+        paired = paired && round_trip(size, [](size_t n) { return ::operator new(n); }, [](void* p, size_t n) { ::operator delete(p, n); });
+        paired = paired && round_trip(size, [](size_t n) { return ::operator new[](n); }, [](void* p, size_t) { ::operator delete[](p); });
+        paired = paired && round_trip(size, [](size_t n) { return ::operator new[](n); }, [](void* p, size_t n) { ::operator delete[](p, n); });
+        paired = paired && round_trip(size, [](size_t n) { return ::operator new(n, std::nothrow); }, [](void* p, size_t) { ::operator delete(p, std::nothrow); });
+        paired = paired && round_trip(size, [](size_t n) { return ::operator new[](n, std::nothrow); }, [](void* p, size_t) { ::operator delete[](p, std::nothrow); });
+        co_yield{ paired, std::format("plain, sized and nothrow new/delete of `{}` bytes should round-trip", size) };
+        for (size_t alignment : { size_t(64), size_t(4096), size_t(64 * 1024) })
+        {
+            const auto al = std::align_val_t(alignment);
+            auto aligned_new = [al, alignment](size_t n) {
+                void* p = ::operator new(n, al);
+                return reinterpret_cast<std::uintptr_t>(p) % alignment == 0 ? p : nullptr;
+            };
+            paired = paired && round_trip(size, aligned_new, [al](void* p, size_t) { ::operator delete(p, al); });
+            paired = paired && round_trip(size, aligned_new, [al](void* p, size_t n) { ::operator delete(p, n, al); });
+            paired = paired && round_trip(size, [al](size_t n) { return ::operator new[](n, al, std::nothrow); }, [al](void* p, size_t) { ::operator delete[](p, al, std::nothrow); });
+            co_yield{ paired, std::format("aligned new/delete of `{}` bytes at `{}` should round-trip", size, alignment) };
+        }
+    }
+    co_yield nullptr;
+
+    co_yield "grow a std::vector<int> to 10000 elements";
+    const size_t allocations = ap.total_allocations;
+    before = ap.current_allocated_bytes;
+    size_t peak = 0;
+    {
+        std::vector<int> v;
+        for (int i = 0; i < 10000; ++i) { v.push_back(i); }
+        peak = ap.current_allocated_bytes - before;
+    }
+    const size_t released = ap.current_allocated_bytes;
+    co_yield{ ap.total_allocations - allocations >= 10, std::format("each growth of the vector should allocate through alloc_proxy, but only `{}` allocations are counted", ap.total_allocations - allocations) };
+    co_yield{ peak >= 10000 * sizeof(int), std::format("the vector's storage should be counted, but only `{}` bytes are", peak) };
+    co_yield{ released == before, "destroying the vector should give its storage back" };
+    co_yield nullptr;
+
+    co_yield "retry through the new_handler";
+    static int handler_calls = 0;
+    handler_calls = 0;
+    std::set_new_handler([] {
+        if (++handler_calls == 2) { std::set_new_handler(nullptr); }
+    });
+    bool thrown = false;
+    try { ::operator delete(::operator new(size_t(1) << 62)); } catch (const std::bad_alloc&) { thrown = true; }
+    co_yield{ thrown && handler_calls == 2, std::format("operator new should call the new_handler until it is removed and then throw, but it was called `{}` times", handler_calls) };
+    co_yield{ ::operator new(size_t(1) << 62, std::nothrow) == nullptr, "nothrow new should return nullptr when no new_handler is installed" };
+    co_return;
+}
+
+case_t sample_global_new()
+{
+#ifndef YAN_ALLOC_SAMPLE
+    co_yield { case_t::state::DISMISSED, "test for allocation sampling has been dismissed, define YAN_ALLOC_SAMPLE to enable it." };
+#else
+    auto& sampler = ap.sampler();
+    const size_t interval = sampler.interval();
+
+    co_yield "new 1000 arrays of 1024 bytes, sampling every 4096 bytes on average";
+    sampler.set_interval(4096);
+    std::vector<std::unique_ptr<char[]>> arrays;
+    for (size_t i = 0; i < 1000; ++i) { arrays.emplace_back(new char[1024]); }
+
+    co_yield "summarize the samples while operator new itself is being sampled";
+    // live 与 report 内部的分配同样经过 _alloc_proxy，不应在持有采样锁时再进入采样器。
+    size_t estimated = 0;
+    for (auto& stack : sampler.live()) { estimated += stack.estimated_bytes; }
+    co_yield{ estimated > 750 * 1024 && estimated < 1500 * 1024, std::format("the estimated live bytes should be about `{}`, but it actually is `{}`", 1000 * 1024, estimated) };
+    co_yield{ sampler.report().starts_with("estimated live bytes: "), "the report should start with the estimated live bytes" };
+    sampler.set_interval(64);
+    bool reported = true;
+    for (int i = 0; i < 100; ++i) { reported = reported && !sampler.live().empty() && !sampler.report().empty(); }
+    co_yield{ reported, "live and report should keep working when nearly every allocation is sampled" };
+
+    co_yield "delete them";
+    arrays.clear();
+    arrays.shrink_to_fit();
+    sampler.set_interval(interval);
+    estimated = 0;
+    for (auto& stack : sampler.live()) { estimated += stack.estimated_bytes; }
+    co_yield{ estimated < 250 * 1024, std::format("the estimated live bytes should drop after deleting the arrays, but it actually is `{}`", estimated) };
+#endif
+    co_return;
+}
+
+    }
+}
+
+int main()
+{
+    my::test::test t;
+    t.new_case(my::test::global_new(), "global operator new and delete");
+    t.new_case(my::test::sample_global_new(), "sampling the global operator new");
+}
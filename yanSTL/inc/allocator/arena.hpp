@@ -0,0 +1,199 @@
+#pragma once
+#include "../yan_allocator.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace my
+{
+
+// 单调增长的内存区域：分配只是移动指针，回收是空操作。
+// 内存以块为单位向 _alloc_proxy 申请，泄漏统计因此能看到这些块；
+// 块内的对象通过 rewind/release 或 arena_scope 一次性归还。
+class arena_resource
+{
+    struct chunk
+    {
+        chunk* prev;
+        size_t size;
+    };
+    static constexpr size_t _header_size = (sizeof(chunk) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+public:
+    static constexpr size_t default_chunk_bytes = 64 * 1024;
+    static constexpr size_t max_chunk_bytes = 4 * 1024 * 1024;
+
+    // 记录 arena 的某个位置，之后可以回退到这里。
+    struct marker
+    {
+        chunk* head;
+        std::byte* cursor;
+    };
+
+    explicit arena_resource(size_t chunk_bytes = default_chunk_bytes) noexcept
+        : _next_chunk_bytes(std::max(chunk_bytes, 2 * _header_size)) {}
+    arena_resource(const arena_resource&) = delete;
+    arena_resource& operator=(const arena_resource&) = delete;
+    ~arena_resource()
+    {
+        release();
+    }
+
+    // 分配 bytes 字节、按 alignment 对齐的内存。
+    [[nodiscard]] void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        const std::uintptr_t cursor = reinterpret_cast<std::uintptr_t>(_cursor);
+        const size_t padding = ((cursor + alignment - 1) & ~(std::uintptr_t(alignment) - 1)) - cursor;
+        const size_t space = static_cast<size_t>(_end - _cursor);
+        if (_cursor == nullptr || padding > space || bytes > space - padding) [[unlikely]]
+        {
+            return _allocate_slow(bytes, alignment);
+        }
+        std::byte* ptr = _cursor + padding;
+        _cursor = ptr + bytes;
+        return ptr;
+    }
+
+    // 单个对象的回收是空操作。
+    void deallocate(void*, size_t, size_t = alignof(std::max_align_t)) noexcept {}
+
+    marker mark() const noexcept
+    {
+        return { _head, _cursor };
+    }
+
+    // 回退到 m 记录的位置，此后分配的块全部归还（保留最大的一块备用）。
+    void rewind(marker m) noexcept
+    {
+        while (_head != m.head)
+        {
+            chunk* prev = _head->prev;
+            _retire(_head);
+            _head = prev;
+        }
+        _cursor = m.cursor;
+        _end = _head ? reinterpret_cast<std::byte*>(_head) + _head->size : nullptr;
+    }
+
+    // 归还所有块，包括备用块。
+    void release() noexcept
+    {
+        rewind({ nullptr, nullptr });
+        if (_spare != nullptr)
+        {
+            _alloc_proxy::get_instance().deallocate(_spare, _spare->size);
+            _spare = nullptr;
+        }
+    }
+
+private:
+    chunk* _head = nullptr;
+    chunk* _spare = nullptr;
+    std::byte* _cursor = nullptr;
+    std::byte* _end = nullptr;
+    size_t _next_chunk_bytes;
+
+    void* _allocate_slow(size_t bytes, size_t alignment)
+    {
+        if (bytes > std::numeric_limits<size_t>::max() / 2)
+        {
+            throw std::bad_alloc();
+        }
+        const size_t needed = _header_size + bytes + (alignment > alignof(std::max_align_t) ? alignment : 0);
+        chunk* c;
+        if (_spare != nullptr && _spare->size >= needed)
+        {
+            c = std::exchange(_spare, nullptr);
+        }
+        else
+        {
+            const size_t size = std::max(_next_chunk_bytes, needed);
+            c = static_cast<chunk*>(_alloc_proxy::get_instance().allocate(size));
+            c->size = size;
+            _next_chunk_bytes = std::min(_next_chunk_bytes * 2, std::max(max_chunk_bytes, _next_chunk_bytes));
+        }
+        c->prev = _head;
+        _head = c;
+        _cursor = reinterpret_cast<std::byte*>(c) + _header_size;
+        _end = reinterpret_cast<std::byte*>(c) + c->size;
+        return allocate(bytes, alignment);
+    }
+
+    void _retire(chunk* c) noexcept
+    {
+        if (_spare == nullptr || _spare->size < c->size)
+        {
+            std::swap(_spare, c);
+        }
+        if (c != nullptr)
+        {
+            _alloc_proxy::get_instance().deallocate(c, c->size);
+        }
+    }
+};
+
+// 作用域结束时把 arena 回退到进入作用域时的位置，
+// 其间分配的所有临时对象随之一次性释放（不调用析构函数）。
+class arena_scope
+{
+public:
+    explicit arena_scope(arena_resource& arena) noexcept
+        : _arena(arena), _marker(arena.mark()) {}
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+    ~arena_scope()
+    {
+        _arena.rewind(_marker);
+    }
+
+private:
+    arena_resource& _arena;
+    arena_resource::marker _marker;
+};
+
+// 从 arena_resource 中分配内存的分配器，deallocate 是空操作。
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    arena_allocator(arena_resource& arena) noexcept : _arena(&arena) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : _arena(other.resource()) {}
+
+    [[nodiscard]] T* allocate(size_type n)
+    {
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_type) noexcept {}
+
+    arena_resource* resource() const noexcept
+    {
+        return _arena;
+    }
+
+    // 使用同一个 arena 的分配器相等。
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept
+    {
+        return _arena == other.resource();
+    }
+
+private:
+    arena_resource* _arena;
+};
+
+} // namespace my
@@ -0,0 +1,355 @@
+#pragma once
+#include "system.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define YAN_ALLOC_HAS_MMAP
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+#define YAN_ALLOC_HAS_MREMAP
+#endif
+#endif
+
+namespace my
+{
+
+// 大块内存直接向操作系统映射页面，不经过堆，因此不会在堆中留下碎片。
+// 映射的字节数按级别取整，回收的映射先放进按级别划分的小缓存，供下一个同级别的请求直接复用，
+// 省去 mmap/munmap 与改写页表的开销；缓存满时才解除映射。
+// 缓存中驻留的页面总量有上限，超出的块先以 MADV_DONTNEED 把页面交还系统，只保留地址空间。
+// 定义 YAN_ALLOC_HUGE_PAGES 时，跨越大页的映射按大页对齐并申请透明大页（MADV_HUGEPAGE）；
+// 默认不申请，因为大页在首次访问时要整页清零，对频繁分配、只用一部分的临时缓冲区反而更慢。
+struct _large_pages
+{
+    static constexpr std::size_t threshold = 256 * 1024; // 不小于该字节数的请求走这条路径
+    static constexpr std::size_t huge_page_bytes = 2 * 1024 * 1024;
+    static constexpr std::size_t cache_max_bytes = 64 * 1024 * 1024;      // 更大的映射不缓存
+    static constexpr std::size_t cache_slots = 4;                         // 每个级别缓存的映射数
+    static constexpr std::size_t cache_resident_bytes = 64 * 1024 * 1024; // 缓存中驻留页面的上限
+
+    static std::size_t page_size() noexcept
+    {
+#if defined(_WIN32)
+        static const std::size_t size = [] {
+            SYSTEM_INFO info;
+            ::GetSystemInfo(&info);
+            return static_cast<std::size_t>(info.dwPageSize);
+        }();
+#elif defined(YAN_ALLOC_HAS_MMAP)
+        static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#else
+        static constexpr std::size_t size = 4096;
+#endif
+        return size;
+    }
+
+    // 映射的实际字节数：每个 2 的幂区间等分为 4 个级别，按级别（至少按页）取整。
+    // 地址空间最多多占 25%，未访问的页面不占物理内存。
+    static std::size_t mapped_size(std::size_t size) noexcept
+    {
+        const std::size_t step = std::max(std::bit_floor(size) / 4, page_size());
+        return (size + step - 1) & ~(step - 1);
+    }
+
+    static void* allocate(std::size_t size)
+    {
+        if (size > SIZE_MAX / 2)
+        {
+            throw std::bad_alloc();
+        }
+        const std::size_t bytes = mapped_size(size);
+#if defined(_WIN32) || defined(YAN_ALLOC_HAS_MMAP)
+        if (void* ptr = _take(bytes))
+        {
+            return ptr;
+        }
+        return _map(bytes);
+#else
+        return _system_heap::allocate(bytes);
+#endif
+    }
+
+    static void deallocate(void* ptr, std::size_t size) noexcept
+    {
+#if defined(_WIN32) || defined(YAN_ALLOC_HAS_MMAP)
+        const std::size_t bytes = mapped_size(size);
+        if (!_give(ptr, bytes))
+        {
+            _unmap(ptr, bytes);
+        }
+#else
+        (void)size;
+        _system_heap::deallocate(ptr);
+#endif
+    }
+
+    // 解除缓存中所有映射，把地址空间交还系统。
+    static void trim() noexcept
+    {
+#if defined(_WIN32) || defined(YAN_ALLOC_HAS_MMAP)
+        for (;;)
+        {
+            _cached_mapping victim{};
+            {
+                std::lock_guard lock(_cache_mutex);
+                for (std::size_t i = 0; i < _cache_classes && victim.ptr == nullptr; ++i)
+                {
+                    if (_cache_counts[i] != 0)
+                    {
+                        victim = _cache[i][--_cache_counts[i]];
+                        _cache_resident -= victim.resident ? victim.bytes : 0;
+                    }
+                }
+            }
+            if (victim.ptr == nullptr)
+            {
+                return;
+            }
+            _unmap(victim.ptr, victim.bytes);
+        }
+#endif
+    }
+
+    // 尝试把 old_size 字节的映射原地扩张到 new_size 字节（不小于 old_size），失败时映射保持不变。
+    // 同一级别内的余量直接可用；Linux 上再用 mremap 在原地址之后追加页面，
+    // 之后的地址空间已被占用时失败。
+    static bool try_expand(void* ptr, std::size_t old_size, std::size_t new_size) noexcept
+    {
+        if (new_size > SIZE_MAX / 2)
+        {
+            return false;
+        }
+        const std::size_t old_bytes = mapped_size(old_size), new_bytes = mapped_size(new_size);
+        if (new_bytes <= old_bytes)
+        {
+            return true;
+        }
+#if defined(YAN_ALLOC_HAS_MREMAP)
+        return ::mremap(ptr, old_bytes, new_bytes, 0) != MAP_FAILED;
+#else
+        (void)ptr;
+        return false;
+#endif
+    }
+
+    // 把 old_size 字节的映射扩张到 new_size 字节（不小于 old_size），内容不变，地址可能改变。
+    // Linux 上由 mremap 先尝试原地扩张，否则改写页表把页面整体搬走，不复制数据；
+    // 其他平台分配新的映射并复制。失败时抛出 std::bad_alloc，原映射保持不变。
+    static void* reallocate(void* ptr, std::size_t old_size, std::size_t new_size)
+    {
+        if (new_size > SIZE_MAX / 2)
+        {
+            throw std::bad_alloc();
+        }
+        const std::size_t old_bytes = mapped_size(old_size), new_bytes = mapped_size(new_size);
+        if (new_bytes <= old_bytes)
+        {
+            return ptr;
+        }
+#if defined(YAN_ALLOC_HAS_MREMAP)
+        if (::mremap(ptr, old_bytes, new_bytes, 0) != MAP_FAILED)
+        {
+            return ptr;
+        }
+#if defined(YAN_ALLOC_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+        if (new_bytes >= huge_page_bytes)
+        {
+            // 搬到新映射的位置上，沿用 allocate 的大页对齐；
+            // 对齐不变时内核可以整块搬移大页的页表项，不必拆分大页。
+            void* dest = allocate(new_size);
+            if (::mremap(ptr, old_bytes, new_bytes, MREMAP_MAYMOVE | MREMAP_FIXED, dest) == MAP_FAILED)
+            {
+                deallocate(dest, new_size);
+                throw std::bad_alloc();
+            }
+            // 搬来的映射沿用旧映射的属性，重新申请透明大页。
+            ::madvise(dest, new_bytes, MADV_HUGEPAGE);
+            return dest;
+        }
+#endif
+        // 由内核挑选新位置，不必先映射一块目标区域。
+        void* dest = ::mremap(ptr, old_bytes, new_bytes, MREMAP_MAYMOVE);
+        if (dest == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        return dest;
+#else
+        void* fresh = allocate(new_size);
+        std::memcpy(fresh, ptr, old_size);
+        deallocate(ptr, old_size);
+        return fresh;
+#endif
+    }
+
+private:
+#if defined(_WIN32) || defined(YAN_ALLOC_HAS_MMAP)
+    struct _cached_mapping
+    {
+        void* ptr;
+        std::size_t bytes;
+        bool resident; // 页面是否仍驻留，计入 _cache_resident
+    };
+
+    // 级别编号：[threshold, cache_max_bytes] 内每个 2 的幂区间 4 级。
+    static constexpr std::size_t _cache_classes = (std::bit_width(cache_max_bytes) - std::bit_width(threshold)) * 4 + 1;
+
+    static inline std::mutex _cache_mutex;
+    static inline _cached_mapping _cache[_cache_classes][cache_slots]{};
+    static inline std::size_t _cache_counts[_cache_classes]{};
+    static inline std::size_t _cache_resident = 0;
+
+    static std::size_t _cache_class(std::size_t bytes) noexcept
+    {
+        const std::size_t width = std::bit_width(bytes);
+        return (width - std::bit_width(threshold)) * 4 + (bytes >> (width - 3) & 3);
+    }
+
+    static bool _cacheable(std::size_t bytes) noexcept
+    {
+        return bytes >= threshold && bytes <= cache_max_bytes;
+    }
+
+    // 从缓存中取出字节数恰为 bytes 的映射，没有时返回空。
+    static void* _take(std::size_t bytes) noexcept
+    {
+        if (!_cacheable(bytes))
+        {
+            return nullptr;
+        }
+        const std::size_t i = _cache_class(bytes);
+        std::lock_guard lock(_cache_mutex);
+        // 后放入的在末尾，更可能仍驻留。
+        for (std::size_t n = _cache_counts[i]; n != 0; --n)
+        {
+            const _cached_mapping found = _cache[i][n - 1];
+            if (found.bytes == bytes)
+            {
+                std::copy(_cache[i] + n, _cache[i] + _cache_counts[i], _cache[i] + n - 1);
+                --_cache_counts[i];
+                _cache_resident -= found.resident ? bytes : 0;
+                return found.ptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // 把映射放进缓存，所在级别已满时返回 false。
+    // 驻留页面超过上限时先交还页面；交还期间映射不在缓存中，不会被别的线程取走。
+    static bool _give(void* ptr, std::size_t bytes) noexcept
+    {
+        if (!_cacheable(bytes))
+        {
+            return false;
+        }
+        const std::size_t i = _cache_class(bytes);
+        {
+            std::lock_guard lock(_cache_mutex);
+            if (_cache_counts[i] == cache_slots)
+            {
+                return false;
+            }
+            if (_cache_resident + bytes <= cache_resident_bytes)
+            {
+                _cache_resident += bytes;
+                _cache[i][_cache_counts[i]++] = { ptr, bytes, true };
+                return true;
+            }
+        }
+        _release(ptr, bytes);
+        std::lock_guard lock(_cache_mutex);
+        if (_cache_counts[i] == cache_slots)
+        {
+            return false;
+        }
+        _cache[i][_cache_counts[i]++] = { ptr, bytes, false };
+        return true;
+    }
+#endif
+
+#if defined(_WIN32)
+    static void* _map(std::size_t bytes)
+    {
+        void* ptr = ::VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void _unmap(void* ptr, std::size_t) noexcept
+    {
+        ::VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+
+    // 页面内容可以丢弃，系统需要时不必写回页面文件。
+    static void _release(void* ptr, std::size_t bytes) noexcept
+    {
+        ::VirtualAlloc(ptr, bytes, MEM_RESET, PAGE_READWRITE);
+    }
+#elif defined(YAN_ALLOC_HAS_MMAP)
+    static void* _map_pages(std::size_t bytes)
+    {
+        void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void* _map(std::size_t bytes)
+    {
+#if defined(YAN_ALLOC_HUGE_PAGES)
+        if (bytes >= huge_page_bytes)
+        {
+            // 多映射一个大页再裁掉首尾，使起始地址按大页对齐，
+            // 透明大页才能覆盖整个区域。
+            auto* raw = static_cast<std::byte*>(_map_pages(bytes + huge_page_bytes));
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw);
+            const std::size_t head = ((address + huge_page_bytes - 1) & ~(huge_page_bytes - 1)) - address;
+            if (head != 0)
+            {
+                ::munmap(raw, head);
+            }
+            if (head != huge_page_bytes)
+            {
+                ::munmap(raw + head + bytes, huge_page_bytes - head);
+            }
+            std::byte* ptr = raw + head;
+#if defined(MADV_HUGEPAGE)
+            ::madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+            return ptr;
+        }
+#endif
+        return _map_pages(bytes);
+    }
+
+    static void _unmap(void* ptr, std::size_t bytes) noexcept
+    {
+        ::munmap(ptr, bytes);
+    }
+
+    // 交还物理页面但保留映射，再次访问时得到清零的页面。
+    static void _release(void* ptr, std::size_t bytes) noexcept
+    {
+        ::madvise(ptr, bytes, MADV_DONTNEED);
+    }
+#endif
+};
+
+} // namespace my
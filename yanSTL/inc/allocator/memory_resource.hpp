@@ -0,0 +1,470 @@
+#pragma once
+#include "../yan_allocator.hpp"
+#include "arena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace my
+{
+
+// 内存资源的抽象基类。容器通过 polymorphic_allocator 持有它的指针，
+// 运行时更换资源即可改变分配策略，不产生新的模板实例。
+class memory_resource
+{
+public:
+    virtual ~memory_resource() = default;
+
+    [[nodiscard]] void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        return do_allocate(bytes, alignment);
+    }
+
+    void deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        do_deallocate(p, bytes, alignment);
+    }
+
+    // 一方分配的内存能否由另一方回收。
+    bool is_equal(const memory_resource& other) const noexcept
+    {
+        return do_is_equal(other);
+    }
+
+    friend bool operator==(const memory_resource& a, const memory_resource& b) noexcept
+    {
+        return &a == &b || a.is_equal(b);
+    }
+
+private:
+    virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+    virtual void do_deallocate(void* p, size_t bytes, size_t alignment) = 0;
+    virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+};
+
+// 经由 _alloc_proxy 分配的资源，泄漏统计能看到这些内存。
+class _new_delete_resource final : public memory_resource
+{
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return _alloc_proxy::get_instance().allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        _alloc_proxy::get_instance().deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// 任何分配都抛出 std::bad_alloc 的资源，用来确认某段代码不分配内存。
+class _null_memory_resource final : public memory_resource
+{
+    void* do_allocate(size_t, size_t) override
+    {
+        throw std::bad_alloc();
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+inline memory_resource* new_delete_resource() noexcept
+{
+    // 与中心池一样永不析构。
+    alignas(_new_delete_resource) static std::byte storage[sizeof(_new_delete_resource)];
+    static memory_resource* instance = ::new (storage) _new_delete_resource;
+    return instance;
+}
+
+inline memory_resource* null_memory_resource() noexcept
+{
+    static _null_memory_resource instance;
+    return &instance;
+}
+
+inline std::atomic<memory_resource*>& _default_resource() noexcept
+{
+    static std::atomic<memory_resource*> resource{ new_delete_resource() };
+    return resource;
+}
+
+inline memory_resource* get_default_resource() noexcept
+{
+    return _default_resource().load(std::memory_order_acquire);
+}
+
+// 设置默认资源并返回原先的资源，传入空指针时恢复为 new_delete_resource()。
+inline memory_resource* set_default_resource(memory_resource* r) noexcept
+{
+    return _default_resource().exchange(r ? r : new_delete_resource(), std::memory_order_acq_rel);
+}
+
+// 单调资源：分配只是移动指针，回收是空操作，release 或析构时一次性归还。
+// 先用构造时给出的缓冲区，用完后向上游资源申请成块的内存，块的大小逐次翻倍；
+// 上游可以是池资源，release 后块回到池中供下一次使用。
+class monotonic_buffer_resource : public memory_resource
+{
+public:
+    static constexpr size_t default_chunk_bytes = arena_resource::default_chunk_bytes;
+    static constexpr size_t max_chunk_bytes = arena_resource::max_chunk_bytes;
+
+    explicit monotonic_buffer_resource(memory_resource* upstream = get_default_resource()) noexcept
+        : monotonic_buffer_resource(default_chunk_bytes, upstream) {}
+    explicit monotonic_buffer_resource(size_t initial_size, memory_resource* upstream = get_default_resource()) noexcept
+        : _upstream(upstream), _initial_chunk_bytes(std::max(initial_size, 2 * _header_size)), _next_chunk_bytes(_initial_chunk_bytes) {}
+    // 先从 [buffer, buffer + size) 分配，缓冲区由调用者持有。
+    monotonic_buffer_resource(void* buffer, size_t size, memory_resource* upstream = get_default_resource()) noexcept
+        : _upstream(upstream), _buffer(static_cast<std::byte*>(buffer)), _buffer_size(size),
+          _cursor(_buffer), _end(_buffer + size), _initial_chunk_bytes(std::max(size * 2, 2 * _header_size)), _next_chunk_bytes(_initial_chunk_bytes) {}
+    monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+    monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+    ~monotonic_buffer_resource() override
+    {
+        release();
+    }
+
+    // 把所有块还给上游，之后重新从初始缓冲区开始分配，块的大小也从头增长。
+    void release() noexcept
+    {
+        while (_chunks != nullptr)
+        {
+            chunk* c = std::exchange(_chunks, _chunks->prev);
+            _upstream->deallocate(c, c->size);
+        }
+        _cursor = _buffer;
+        _end = _buffer + _buffer_size;
+        _next_chunk_bytes = _initial_chunk_bytes;
+    }
+
+    memory_resource* upstream_resource() const noexcept
+    {
+        return _upstream;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        const std::uintptr_t cursor = reinterpret_cast<std::uintptr_t>(_cursor);
+        const size_t padding = ((cursor + alignment - 1) & ~(std::uintptr_t(alignment) - 1)) - cursor;
+        const size_t space = static_cast<size_t>(_end - _cursor);
+        if (_cursor == nullptr || padding > space || bytes > space - padding) [[unlikely]]
+        {
+            return _allocate_slow(bytes, alignment);
+        }
+        std::byte* ptr = _cursor + padding;
+        _cursor = ptr + bytes;
+        return ptr;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct chunk
+    {
+        chunk* prev;
+        size_t size;
+    };
+    static constexpr size_t _header_size = (sizeof(chunk) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    memory_resource* _upstream;
+    std::byte* _buffer = nullptr;
+    size_t _buffer_size = 0;
+    chunk* _chunks = nullptr;
+    std::byte* _cursor = nullptr;
+    std::byte* _end = nullptr;
+    size_t _initial_chunk_bytes;
+    size_t _next_chunk_bytes;
+
+    void* _allocate_slow(size_t bytes, size_t alignment)
+    {
+        if (bytes > std::numeric_limits<size_t>::max() / 2)
+        {
+            throw std::bad_alloc();
+        }
+        const size_t needed = _header_size + bytes + (alignment > alignof(std::max_align_t) ? alignment : 0);
+        const size_t size = std::max(_next_chunk_bytes, needed);
+        auto* c = static_cast<chunk*>(_upstream->allocate(size));
+        c->prev = _chunks;
+        c->size = size;
+        _chunks = c;
+        _next_chunk_bytes = std::min(_next_chunk_bytes * 2, std::max(max_chunk_bytes, _next_chunk_bytes));
+        _cursor = reinterpret_cast<std::byte*>(c) + _header_size;
+        _end = reinterpret_cast<std::byte*>(c) + size;
+        return do_allocate(bytes, alignment);
+    }
+};
+
+// 按 _size_class 分级的池资源，不加锁。
+// 每个级别从上游资源申请成块的内存切分，回收的块挂回所在级别的空闲链表；
+// 超过 max_pooled_bytes 或对齐要求超过 max_align_t 的请求直接交给上游。
+// release 或析构时把所有块还给上游。
+class unsynchronized_pool_resource : public memory_resource
+{
+public:
+    static constexpr size_t max_pooled_bytes = 4096;
+    static constexpr size_t max_blocks_per_chunk = 256;
+
+    explicit unsynchronized_pool_resource(memory_resource* upstream = get_default_resource()) noexcept
+        : _upstream(upstream) {}
+    unsynchronized_pool_resource(const unsynchronized_pool_resource&) = delete;
+    unsynchronized_pool_resource& operator=(const unsynchronized_pool_resource&) = delete;
+    ~unsynchronized_pool_resource() override
+    {
+        release();
+    }
+
+    void release() noexcept
+    {
+        while (_chunks != nullptr)
+        {
+            chunk* c = std::exchange(_chunks, _chunks->prev);
+            _upstream->deallocate(c, c->size);
+        }
+        for (auto& bin : _bins)
+        {
+            bin = {};
+        }
+    }
+
+    memory_resource* upstream_resource() const noexcept
+    {
+        return _upstream;
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (bytes > max_pooled_bytes || alignment > alignof(std::max_align_t))
+        {
+            return _upstream->allocate(bytes, alignment);
+        }
+        auto& bin = _bins[_size_class::index(bytes)];
+        if (_free_block* block = bin.free)
+        {
+            bin.free = block->next;
+            return block;
+        }
+        return _carve(_size_class::index(bytes));
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        if (bytes > max_pooled_bytes || alignment > alignof(std::max_align_t))
+        {
+            _upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+        auto& bin = _bins[_size_class::index(bytes)];
+        auto* block = static_cast<_free_block*>(p);
+        block->next = bin.free;
+        bin.free = block;
+    }
+
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t _bin_count = _size_class_index(max_pooled_bytes) + 1;
+
+    struct chunk
+    {
+        chunk* prev;
+        size_t size;
+    };
+    static constexpr size_t _header_size = (sizeof(chunk) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    struct bin
+    {
+        _free_block* free = nullptr;
+        size_t next_blocks = 8; // 下一次向上游申请时切出的块数，逐次翻倍
+    };
+
+    memory_resource* _upstream;
+    chunk* _chunks = nullptr;
+    bin _bins[_bin_count];
+
+    void* _carve(size_t cls)
+    {
+        auto& bin = _bins[cls];
+        const size_t block_size = _size_class::size(cls);
+        const size_t n = bin.next_blocks;
+        const size_t size = _header_size + n * block_size;
+        auto* c = static_cast<chunk*>(_upstream->allocate(size));
+        c->prev = _chunks;
+        c->size = size;
+        _chunks = c;
+        bin.next_blocks = std::min(n * 2, max_blocks_per_chunk);
+        // 第一块交给调用者，其余挂入空闲链表。
+        std::byte* first = reinterpret_cast<std::byte*>(c) + _header_size;
+        for (size_t i = n - 1; i != 0; --i)
+        {
+            auto* block = reinterpret_cast<_free_block*>(first + i * block_size);
+            block->next = bin.free;
+            bin.free = block;
+        }
+        return first;
+    }
+};
+
+// 加锁的池资源，可在多个线程间共享。
+class synchronized_pool_resource : public unsynchronized_pool_resource
+{
+public:
+    using unsynchronized_pool_resource::unsynchronized_pool_resource;
+
+    void release() noexcept
+    {
+        std::lock_guard lock(_mutex);
+        unsynchronized_pool_resource::release();
+    }
+
+private:
+    std::mutex _mutex;
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        std::lock_guard lock(_mutex);
+        return unsynchronized_pool_resource::do_allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::lock_guard lock(_mutex);
+        unsynchronized_pool_resource::do_deallocate(p, bytes, alignment);
+    }
+};
+
+// 从 memory_resource 分配内存的分配器。
+// 复制构造容器时不传播资源（新容器使用默认资源），赋值与交换时也不传播。
+template <typename T = std::byte>
+class polymorphic_allocator
+{
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+
+    polymorphic_allocator() noexcept : _resource(get_default_resource()) {}
+    polymorphic_allocator(memory_resource* r) noexcept : _resource(r) {}
+    polymorphic_allocator(const polymorphic_allocator&) = default;
+    template <typename U>
+    polymorphic_allocator(const polymorphic_allocator<U>& other) noexcept : _resource(other.resource()) {}
+    polymorphic_allocator& operator=(const polymorphic_allocator&) = delete;
+
+    [[nodiscard]] T* allocate(size_type n)
+    {
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_type n) noexcept
+    {
+        _resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    [[nodiscard]] void* allocate_bytes(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        return _resource->allocate(bytes, alignment);
+    }
+
+    void deallocate_bytes(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t)) noexcept
+    {
+        _resource->deallocate(p, bytes, alignment);
+    }
+
+    template <typename U>
+    [[nodiscard]] U* allocate_object(size_t n = 1)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(U))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<U*>(allocate_bytes(n * sizeof(U), alignof(U)));
+    }
+
+    template <typename U>
+    void deallocate_object(U* p, size_t n = 1) noexcept
+    {
+        deallocate_bytes(p, n * sizeof(U), alignof(U));
+    }
+
+    // 分配并构造一个 U，构造失败时归还内存。
+    template <typename U, typename... Args>
+    [[nodiscard]] U* new_object(Args&&... args)
+    {
+        U* p = allocate_object<U>();
+        try
+        {
+            construct(p, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            deallocate_object(p);
+            throw;
+        }
+        return p;
+    }
+
+    template <typename U>
+    void delete_object(U* p)
+    {
+        std::destroy_at(p);
+        deallocate_object(p);
+    }
+
+    // 按 uses-allocator 规则构造：U 接受分配器时把本分配器（转换后）传给它，
+    // 于是嵌套的容器与 pair 的成员也从同一个资源分配。
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
+    }
+
+    polymorphic_allocator select_on_container_copy_construction() const noexcept
+    {
+        return polymorphic_allocator();
+    }
+
+    memory_resource* resource() const noexcept
+    {
+        return _resource;
+    }
+
+    // 资源相等的分配器相等。
+    template <typename U>
+    bool operator==(const polymorphic_allocator<U>& other) const noexcept
+    {
+        return *_resource == *other.resource();
+    }
+
+private:
+    memory_resource* _resource;
+};
+
+} // namespace my
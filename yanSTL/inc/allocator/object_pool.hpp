@@ -0,0 +1,271 @@
+#pragma once
+#include "../yan_allocator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace my
+{
+
+// 定长块的无锁内存池。
+// 空闲块构成 Treiber 栈，栈顶是“标签 << 32 | 编号 + 1”组成的 64 位整数，
+// 每次修改栈顶都使标签加一，弹出时读到的 next 即使已过时，CAS 也会因标签不同而失败（ABA）。
+// 块按编号寻址：第 k 个 slab 容纳 first_slab_slots << k 个块，新块由原子递增的编号切分，
+// slab 由 Accounting 分配、在池析构时才归还，因此过时的读取也不会访问已释放的内存。
+template <size_t Size, size_t Align, typename Accounting = full_accounting>
+class _fixed_pool
+{
+public:
+    static constexpr size_t slot_alignment = std::max(Align, alignof(std::uint32_t));
+    static constexpr size_t slot_size = (std::max(Size, sizeof(std::uint32_t)) + slot_alignment - 1) / slot_alignment * slot_alignment;
+    static constexpr size_t first_slab_slots = std::max<size_t>(64 * 1024 / slot_size, 16);
+    // 编号加一须能用 32 位表示。
+    static constexpr size_t max_slabs = std::bit_width(std::numeric_limits<std::uint32_t>::max() / first_slab_slots + 1) - 1;
+
+    _fixed_pool() noexcept = default;
+    _fixed_pool(const _fixed_pool&) = delete;
+    _fixed_pool& operator=(const _fixed_pool&) = delete;
+    ~_fixed_pool()
+    {
+        for (size_t k = 0; k < max_slabs; ++k)
+        {
+            if (std::byte* slab = _slabs[k].load(std::memory_order_relaxed))
+            {
+                Accounting::deallocate(slab, _slab_bytes(k), slot_alignment);
+            }
+        }
+    }
+
+    // 进程内共用的池，永不析构。
+    static _fixed_pool& shared()
+    {
+        alignas(_fixed_pool) static std::byte storage[sizeof(_fixed_pool)];
+        static _fixed_pool* instance = ::new (storage) _fixed_pool;
+        return *instance;
+    }
+
+    [[nodiscard]] void* allocate()
+    {
+        std::uint64_t head = _head.load(std::memory_order_acquire);
+        while (_index(head) != 0)
+        {
+            const std::uint32_t index = _index(head) - 1;
+            const std::uint32_t next = _next(index).load(std::memory_order_relaxed);
+            if (_head.compare_exchange_weak(head, _pack(_tag(head) + 1, next), std::memory_order_acquire, std::memory_order_acquire))
+            {
+                return _slot(index);
+            }
+        }
+        return _carve();
+    }
+
+    void deallocate(void* p) noexcept
+    {
+        const std::uint32_t index = _index_of(static_cast<std::byte*>(p));
+        std::uint64_t head = _head.load(std::memory_order_relaxed);
+        do
+        {
+            _next(index).store(_index(head), std::memory_order_relaxed);
+        } while (!_head.compare_exchange_weak(head, _pack(_tag(head) + 1, index + 1), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // 已切分出的块数。
+    size_t capacity() const noexcept
+    {
+        return std::min<size_t>(_carved.load(std::memory_order_relaxed), _slab_begin(max_slabs));
+    }
+
+private:
+    alignas(64) std::atomic<std::uint64_t> _head{ 0 };
+    alignas(64) std::atomic<size_t> _carved{ 0 };
+    std::atomic<std::byte*> _slabs[max_slabs]{};
+
+    static constexpr std::uint32_t _index(std::uint64_t head) noexcept { return static_cast<std::uint32_t>(head); }
+    static constexpr std::uint32_t _tag(std::uint64_t head) noexcept { return static_cast<std::uint32_t>(head >> 32); }
+    static constexpr std::uint64_t _pack(std::uint32_t tag, std::uint32_t index) noexcept
+    {
+        return std::uint64_t(tag) << 32 | index;
+    }
+
+    // 第 k 个 slab 中第一个块的编号。
+    static constexpr size_t _slab_begin(size_t k) noexcept
+    {
+        return first_slab_slots * ((size_t(1) << k) - 1);
+    }
+
+    static constexpr size_t _slab_bytes(size_t k) noexcept
+    {
+        return (first_slab_slots << k) * slot_size;
+    }
+
+    static constexpr size_t _slab_of(size_t index) noexcept
+    {
+        return std::bit_width(index / first_slab_slots + 1) - 1;
+    }
+
+    void* _slot(std::uint32_t index) const noexcept
+    {
+        const size_t k = _slab_of(index);
+        return _slabs[k].load(std::memory_order_acquire) + (index - _slab_begin(k)) * slot_size;
+    }
+
+    // 空闲块的前 4 个字节保存下一个空闲块的编号加一。
+    std::atomic_ref<std::uint32_t> _next(std::uint32_t index) const noexcept
+    {
+        return std::atomic_ref<std::uint32_t>(*static_cast<std::uint32_t*>(_slot(index)));
+    }
+
+    // p 必须来自本池；找不到所在的 slab 时终止程序，而不是把无关的地址挂进空闲链表。
+    std::uint32_t _index_of(std::byte* p) const noexcept
+    {
+        for (size_t k = 0; k < max_slabs; ++k)
+        {
+            std::byte* slab = _slabs[k].load(std::memory_order_relaxed);
+            if (slab != nullptr && p >= slab && p < slab + _slab_bytes(k))
+            {
+                return static_cast<std::uint32_t>(_slab_begin(k) + static_cast<size_t>(p - slab) / slot_size);
+            }
+        }
+        assert(!"_fixed_pool::deallocate: the block does not belong to this pool");
+        std::abort();
+    }
+
+    void* _carve()
+    {
+        const size_t index = _carved.fetch_add(1, std::memory_order_relaxed);
+        if (index >= _slab_begin(max_slabs))
+        {
+            throw std::bad_alloc();
+        }
+        const size_t k = _slab_of(index);
+        std::byte* slab = _slabs[k].load(std::memory_order_acquire);
+        if (slab == nullptr)
+        {
+            // 多个线程可能同时发现 slab 缺失，只保留第一个装入的。
+            auto* fresh = static_cast<std::byte*>(Accounting::allocate(_slab_bytes(k), slot_alignment));
+            if (_slabs[k].compare_exchange_strong(slab, fresh, std::memory_order_acq_rel))
+            {
+                slab = fresh;
+            }
+            else
+            {
+                Accounting::deallocate(fresh, _slab_bytes(k), slot_alignment);
+            }
+        }
+        return slab + (index - _slab_begin(k)) * slot_size;
+    }
+};
+
+// T 类型对象的池。存储从属于这个池，池析构时归还给 _alloc_proxy。
+template <typename T>
+class object_pool
+{
+public:
+    object_pool() noexcept = default;
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    // 分配一个 T 的未初始化存储空间。
+    [[nodiscard]] T* allocate()
+    {
+        return static_cast<T*>(_pool.allocate());
+    }
+
+    void deallocate(T* p) noexcept
+    {
+        _pool.deallocate(p);
+    }
+
+    template <typename... Args>
+    [[nodiscard]] T* create(Args&&... args)
+    {
+        T* p = allocate();
+        try
+        {
+            return std::construct_at(p, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            deallocate(p);
+            throw;
+        }
+    }
+
+    void destroy(T* p) noexcept
+    {
+        std::destroy_at(p);
+        deallocate(p);
+    }
+
+    size_t capacity() const noexcept
+    {
+        return _pool.capacity();
+    }
+
+private:
+    _fixed_pool<sizeof(T), alignof(T)> _pool;
+};
+
+// 单个对象从按 T 的尺寸与对齐共用的池中分配，用于节点式容器与 allocate_shared；
+// 一次分配多个对象时改用 _alloc_proxy。
+// 共用的池与中心池一样伴随整个进程，其 slab 不计入统计，统计只记录每个对象。
+template <typename T>
+class pool_allocator
+{
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+
+    constexpr pool_allocator() noexcept = default;
+    template <typename U>
+    constexpr pool_allocator(const pool_allocator<U>&) noexcept {}
+
+    [[nodiscard]] T* allocate(size_type n)
+    {
+        if (n != 1)
+        {
+            return allocator<T>().allocate(n);
+        }
+        void* p = _shared_pool().allocate();
+        _record_allocate(sizeof(T));
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_type n)
+    {
+        if (n != 1)
+        {
+            allocator<T>().deallocate(p, n);
+            return;
+        }
+        _shared_pool().deallocate(p);
+        _record_deallocate(sizeof(T));
+    }
+
+    template <typename U>
+    constexpr bool operator==(const pool_allocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+private:
+    // 只在成员函数中用到 sizeof(T)，T 在类实例化时可以是不完整类型，
+    // 例如 allocate_shared 的控制块或以自身为元素的容器。
+    static auto& _shared_pool()
+    {
+        return _fixed_pool<sizeof(T), alignof(T), no_accounting>::shared();
+    }
+};
+
+} // namespace my
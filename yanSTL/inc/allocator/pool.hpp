@@ -0,0 +1,335 @@
+#pragma once
+#include "size_class.hpp"
+#include "system.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace my
+{
+
+// 空闲块在自身的存储中保存下一个空闲块的地址，构成侵入式单链表。
+struct _free_block
+{
+    _free_block* next;
+};
+
+class _thread_cache;
+
+// slab 的第一个块用作头部，记录切分出这些块的线程缓存。
+struct _slab_header
+{
+    _thread_cache* owner;
+};
+
+// 记录每个 128 KiB 的地址区间属于哪个级别的 slab，只凭地址就能判断一块内存是否来自内存池。
+// slab 按自身大小（至少 128 KiB）对齐且从不归还，分配时登记一次即可。
+// 两级表覆盖 48 位的用户态地址空间，叶子在首次用到时从系统堆清零分配。
+class _slab_map
+{
+public:
+    static constexpr std::size_t chunk_bits = 17;
+
+    // 返回 ptr 所在 slab 的级别，不在任何 slab 中时返回 _size_class::count。
+    static std::size_t class_of(const void* ptr) noexcept
+    {
+        const std::uintptr_t chunk = reinterpret_cast<std::uintptr_t>(ptr) >> chunk_bits;
+        if (chunk >> (_root_bits + _leaf_bits) != 0)
+        {
+            return _size_class::count;
+        }
+        const _leaf* leaf = _root[chunk >> _leaf_bits].load(std::memory_order_acquire);
+        const std::uint8_t entry = leaf == nullptr ? 0 : leaf->classes[chunk & ((std::size_t(1) << _leaf_bits) - 1)];
+        return entry == 0 ? _size_class::count : entry - 1;
+    }
+
+    // 登记 [slab, slab + bytes) 属于 cls 级别。地址超出范围或无法分配叶子时返回 false。
+    static bool insert(const void* slab, std::size_t bytes, std::size_t cls) noexcept
+    {
+        const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(slab) >> chunk_bits;
+        const std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(slab) + bytes - 1) >> chunk_bits;
+        if (last >> (_root_bits + _leaf_bits) != 0)
+        {
+            return false;
+        }
+        for (std::uintptr_t chunk = first; chunk <= last; ++chunk)
+        {
+            auto& slot = _root[chunk >> _leaf_bits];
+            _leaf* leaf = slot.load(std::memory_order_acquire);
+            if (leaf == nullptr)
+            {
+                auto* fresh = static_cast<_leaf*>(std::calloc(1, sizeof(_leaf)));
+                if (fresh == nullptr)
+                {
+                    return false;
+                }
+                if (slot.compare_exchange_strong(leaf, fresh, std::memory_order_acq_rel))
+                {
+                    leaf = fresh;
+                }
+                else
+                {
+                    std::free(fresh);
+                }
+            }
+            // 区间在登记前不属于任何存活的块，不会有线程同时读取这一项。
+            leaf->classes[chunk & ((std::size_t(1) << _leaf_bits) - 1)] = static_cast<std::uint8_t>(cls + 1);
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::size_t _leaf_bits = 16;
+    static constexpr std::size_t _root_bits = 48 - chunk_bits - _leaf_bits;
+
+    struct _leaf
+    {
+        std::uint8_t classes[std::size_t(1) << _leaf_bits]; // 级别加一，0 表示不是 slab
+    };
+
+    static_assert(_size_class::count < 255);
+
+    static inline constinit std::atomic<_leaf*> _root[std::size_t(1) << _root_bits]{};
+};
+
+// 中心池：分配 slab，并登记所有线程缓存。
+// 线程退出后其缓存被遗弃而不销毁，留待新线程接管，
+// 这样别的线程仍可安全地把属于它的块还回去。
+class _central_pool
+{
+public:
+    static _central_pool& get_instance()
+    {
+        // 中心池永不析构：静态对象的析构函数可能仍在回收内存。
+        alignas(_central_pool) static std::byte storage[sizeof(_central_pool)];
+        static _central_pool* instance = ::new (storage) _central_pool;
+        return *instance;
+    }
+
+    // cls 级别的 slab 的字节数，至少容纳 16 块。slab 按自身大小对齐，
+    // 由块的地址与级别即可找到 slab 头。
+    static constexpr std::size_t slab_bytes(std::size_t cls) noexcept
+    {
+        return std::bit_ceil(std::max<std::size_t>(128 * 1024, 16 * _size_class::size(cls)));
+    }
+
+    static _slab_header* slab_of(void* ptr, std::size_t cls) noexcept
+    {
+        return reinterpret_cast<_slab_header*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(slab_bytes(cls) - 1));
+    }
+
+    static std::byte* allocate_slab(std::size_t cls)
+    {
+        const std::size_t bytes = slab_bytes(cls);
+        void* slab = _system_heap::allocate(bytes, bytes);
+        if (!_slab_map::insert(slab, bytes, cls))
+        {
+            _system_heap::deallocate(slab, bytes);
+            throw std::bad_alloc();
+        }
+        return static_cast<std::byte*>(slab);
+    }
+
+    // 为新线程取得一个线程缓存，优先接管被遗弃的缓存。
+    _thread_cache* acquire();
+    void abandon(_thread_cache* cache) noexcept;
+
+    // 线程退出过程中仍需分配时，加锁使用这个不属于任何线程的缓存。
+    std::mutex& orphan_mutex() noexcept
+    {
+        return _orphan_mutex;
+    }
+
+    _thread_cache& orphan() noexcept;
+
+private:
+    std::mutex _mutex;
+    _thread_cache* _caches = nullptr;
+    std::mutex _orphan_mutex;
+    _thread_cache* _orphan = nullptr;
+
+    _central_pool() = default;
+    _central_pool(const _central_pool&) = delete;
+    _central_pool& operator=(const _central_pool&) = delete;
+};
+
+static_assert(_central_pool::slab_bytes(0) % (std::size_t(1) << _slab_map::chunk_bits) == 0);
+
+// 线程缓存：每个线程为每个尺寸级别持有一条空闲链表，并从自己的 slab 中切分新块。
+// 块总是回到切分它的缓存：所属线程回收时直接挂回空闲链表，不加锁；
+// 其他线程回收时压入所属缓存的远程回收队列（无锁栈），
+// 所属线程在本地链表用尽时一次性取走整个队列。
+class _thread_cache
+{
+public:
+    // fresh: 尚未取得缓存；active: 正常工作；retired: 线程正在退出，缓存已遗弃。
+    enum class state : std::uint8_t { fresh, active, retired };
+
+    static void* allocate(std::size_t cls);
+    static void deallocate(void* ptr, std::size_t cls) noexcept;
+
+private:
+    friend class _central_pool;
+
+    struct free_list
+    {
+        _free_block* head = nullptr;
+        std::byte* cursor = nullptr; // 当前 slab 中尚未切分的部分
+        std::byte* end = nullptr;
+    };
+
+    // 线程退出时遗弃缓存。
+    struct reaper
+    {
+        ~reaper();
+    };
+
+    free_list _lists[_size_class::count];
+    _thread_cache* _next = nullptr;
+    bool _abandoned = false;
+    // 其他线程频繁写入，与所属线程使用的数据分处不同的缓存行。
+    alignas(64) std::atomic<_free_block*> _remote[_size_class::count]{};
+
+    void* _allocate(std::size_t cls)
+    {
+        auto& list = _lists[cls];
+        if (_free_block* block = list.head) [[likely]]
+        {
+            list.head = block->next;
+            return block;
+        }
+        return _refill(cls);
+    }
+
+    void _deallocate_local(void* ptr, std::size_t cls) noexcept
+    {
+        auto& list = _lists[cls];
+        auto* block = static_cast<_free_block*>(ptr);
+        block->next = list.head;
+        list.head = block;
+    }
+
+    void _deallocate_remote(void* ptr, std::size_t cls) noexcept
+    {
+        auto* block = static_cast<_free_block*>(ptr);
+        _free_block* head = _remote[cls].load(std::memory_order_relaxed);
+        do
+        {
+            block->next = head;
+        } while (!_remote[cls].compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // 本地链表用尽：先取回远程回收的块，再从 slab 切分。
+    void* _refill(std::size_t cls)
+    {
+        auto& list = _lists[cls];
+        if (_remote[cls].load(std::memory_order_relaxed) != nullptr)
+        {
+            // 只有所属线程取走整个队列，不存在 ABA 问题。
+            _free_block* block = _remote[cls].exchange(nullptr, std::memory_order_acquire);
+            list.head = block->next;
+            return block;
+        }
+        const std::size_t size = _size_class::size(cls);
+        if (static_cast<std::size_t>(list.end - list.cursor) < size)
+        {
+            std::byte* slab = _central_pool::allocate_slab(cls);
+            reinterpret_cast<_slab_header*>(slab)->owner = this;
+            // 头部占用第一个块，其余的块仍从 slab 起始处按级别字节数对齐。
+            list.cursor = slab + size;
+            list.end = slab + _central_pool::slab_bytes(cls);
+        }
+        void* block = list.cursor;
+        list.cursor += size;
+        return block;
+    }
+
+    static void* _allocate_slow(std::size_t cls);
+};
+
+// 常量初始化且可平凡析构，访问时不需要线程局部变量的初始化检查。
+inline constinit thread_local _thread_cache* _tls_thread_cache = nullptr;
+inline constinit thread_local _thread_cache::state _tls_thread_cache_state{};
+
+inline _thread_cache* _central_pool::acquire()
+{
+    std::lock_guard lock(_mutex);
+    for (_thread_cache* cache = _caches; cache != nullptr; cache = cache->_next)
+    {
+        if (cache->_abandoned)
+        {
+            cache->_abandoned = false;
+            return cache;
+        }
+    }
+    auto* cache = _system_heap::create<_thread_cache>();
+    cache->_next = _caches;
+    _caches = cache;
+    return cache;
+}
+
+inline void _central_pool::abandon(_thread_cache* cache) noexcept
+{
+    std::lock_guard lock(_mutex);
+    cache->_abandoned = true;
+}
+
+inline _thread_cache& _central_pool::orphan() noexcept
+{
+    if (_orphan == nullptr)
+    {
+        _orphan = _system_heap::create<_thread_cache>();
+    }
+    return *_orphan;
+}
+
+inline _thread_cache::reaper::~reaper()
+{
+    _central_pool::get_instance().abandon(_tls_thread_cache);
+    _tls_thread_cache = nullptr;
+    _tls_thread_cache_state = state::retired;
+}
+
+inline void* _thread_cache::allocate(std::size_t cls)
+{
+    if (_thread_cache* cache = _tls_thread_cache) [[likely]]
+    {
+        return cache->_allocate(cls);
+    }
+    return _allocate_slow(cls);
+}
+
+inline void _thread_cache::deallocate(void* ptr, std::size_t cls) noexcept
+{
+    _thread_cache* owner = _central_pool::slab_of(ptr, cls)->owner;
+    if (owner == _tls_thread_cache) [[likely]]
+    {
+        owner->_deallocate_local(ptr, cls);
+    }
+    else
+    {
+        owner->_deallocate_remote(ptr, cls);
+    }
+}
+
+inline void* _thread_cache::_allocate_slow(std::size_t cls)
+{
+    auto& pool = _central_pool::get_instance();
+    if (_tls_thread_cache_state == state::retired)
+    {
+        std::lock_guard lock(pool.orphan_mutex());
+        return pool.orphan()._allocate(cls);
+    }
+    thread_local reaper r;
+    (void)r;
+    _tls_thread_cache = pool.acquire();
+    _tls_thread_cache_state = state::active;
+    return _tls_thread_cache->_allocate(cls);
+}
+
+} // namespace my
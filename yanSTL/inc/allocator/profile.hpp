@@ -0,0 +1,152 @@
+#pragma once
+#include "size_class.hpp"
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+
+namespace my
+{
+
+enum class profile_format { text, json };
+
+// 分配剖析：按尺寸级别统计分配与回收次数、记录当前字节数的峰值，
+// 并按寿命分桶统计回收。只有定义了 YAN_ALLOC_PROFILE 时 _alloc_proxy 才会使用它，
+// 此时每块内存前多出 header_size（或对齐字节数）字节，用来记下分配的时刻。
+// 同一程序的各编译单元必须一致地定义或不定义该宏。
+class _alloc_profiler
+{
+public:
+    static constexpr std::size_t header_size = alignof(std::max_align_t);
+    // 超过 max_small 的请求按 2 的幂分桶。
+    static constexpr std::size_t large_bins = 64 - std::bit_width(_size_class::max_small - 1);
+    static constexpr std::size_t bin_count = _size_class::count + large_bins;
+    // 寿命分桶的上界：1us, 10us, ..., 10s，最后一桶不设上界。
+    static constexpr std::size_t lifetime_buckets = 9;
+
+    static constexpr std::size_t bin(std::size_t size) noexcept
+    {
+        if (size <= _size_class::max_small)
+        {
+            return _size_class::index(size);
+        }
+        return _size_class::count + std::bit_width(size - 1) - std::bit_width(_size_class::max_small - 1) - 1;
+    }
+
+    // 第 i 个分桶容纳的最大字节数。
+    static constexpr std::size_t bin_size(std::size_t i) noexcept
+    {
+        if (i < _size_class::count)
+        {
+            return _size_class::size(i);
+        }
+        const std::size_t shift = i - _size_class::count + std::bit_width(_size_class::max_small - 1) + 1;
+        return shift >= 64 ? ~std::size_t(0) : std::size_t(1) << shift;
+    }
+
+    // block 是多分配了 header 字节的内存块，返回交给用户的地址。
+    // 对齐要求超过 header_size 的分配以对齐字节数作为 header，用户地址仍然对齐。
+    void* on_allocate(void* block, std::size_t size, std::size_t header = header_size) noexcept
+    {
+        *static_cast<std::int64_t*>(block) = _now();
+        _allocations[bin(size)].fetch_add(1, std::memory_order_relaxed);
+        const std::size_t current = _current_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        std::size_t peak = _peak_bytes.load(std::memory_order_relaxed);
+        while (current > peak && !_peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+        return static_cast<std::byte*>(block) + header;
+    }
+
+    // 由用户地址找回内存块的起始地址。
+    void* on_deallocate(void* ptr, std::size_t size, std::size_t header = header_size) noexcept
+    {
+        void* block = static_cast<std::byte*>(ptr) - header;
+        const std::int64_t lifetime = _now() - *static_cast<std::int64_t*>(block);
+        std::size_t bucket = 0;
+        for (std::int64_t bound = 1000; bucket + 1 < lifetime_buckets && lifetime >= bound; bound *= 10)
+        {
+            ++bucket;
+        }
+        _frees[bin(size)].fetch_add(1, std::memory_order_relaxed);
+        _lifetimes[bucket].fetch_add(1, std::memory_order_relaxed);
+        _current_bytes.fetch_sub(size, std::memory_order_relaxed);
+        return block;
+    }
+
+    // 原地扩张：记作旧尺寸的一次回收与新尺寸的一次分配，不计入寿命，分配时刻保持不变。
+    void on_expand(std::size_t old_size, std::size_t new_size) noexcept
+    {
+        _frees[bin(old_size)].fetch_add(1, std::memory_order_relaxed);
+        _allocations[bin(new_size)].fetch_add(1, std::memory_order_relaxed);
+        const std::size_t current = _current_bytes.fetch_add(new_size - old_size, std::memory_order_relaxed) + new_size - old_size;
+        std::size_t peak = _peak_bytes.load(std::memory_order_relaxed);
+        while (current > peak && !_peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+    }
+
+    std::size_t allocations(std::size_t bin) const noexcept { return _allocations[bin].load(std::memory_order_relaxed); }
+    std::size_t frees(std::size_t bin) const noexcept { return _frees[bin].load(std::memory_order_relaxed); }
+    std::size_t lifetimes(std::size_t bucket) const noexcept { return _lifetimes[bucket].load(std::memory_order_relaxed); }
+    std::size_t peak_bytes() const noexcept { return _peak_bytes.load(std::memory_order_relaxed); }
+
+    // 清空各项计数，峰值从当前字节数重新开始。
+    void reset() noexcept
+    {
+        for (auto& c : _allocations) { c.store(0, std::memory_order_relaxed); }
+        for (auto& c : _frees) { c.store(0, std::memory_order_relaxed); }
+        for (auto& c : _lifetimes) { c.store(0, std::memory_order_relaxed); }
+        _peak_bytes.store(_current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // 以文本或 JSON 输出剖析结果，省略计数为零的分桶。
+    std::string report(profile_format format = profile_format::text) const
+    {
+        static constexpr const char* lifetime_names[lifetime_buckets] = {
+            "<1us", "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s"
+        };
+        const bool json = format == profile_format::json;
+        std::string out = json
+            ? std::format("{{\"peak_bytes\":{},\"size_classes\":[", peak_bytes())
+            : std::format("peak bytes: {}\n{:>12}{:>14}{:>14}\n", peak_bytes(), "size", "allocations", "frees");
+        bool first = true;
+        for (std::size_t i = 0; i < bin_count; ++i)
+        {
+            if (allocations(i) == 0 && frees(i) == 0)
+            {
+                continue;
+            }
+            out += json
+                ? std::format("{}{{\"size\":{},\"allocations\":{},\"frees\":{}}}", first ? "" : ",", bin_size(i), allocations(i), frees(i))
+                : std::format("{:>12}{:>14}{:>14}\n", bin_size(i), allocations(i), frees(i));
+            first = false;
+        }
+        out += json ? "],\"lifetimes\":{" : std::format("{:>12}{:>14}\n", "lifetime", "frees");
+        for (std::size_t i = 0; i < lifetime_buckets; ++i)
+        {
+            out += json
+                ? std::format("{}\"{}\":{}", i == 0 ? "" : ",", lifetime_names[i], lifetimes(i))
+                : std::format("{:>12}{:>14}\n", lifetime_names[i], lifetimes(i));
+        }
+        if (json)
+        {
+            out += "}}";
+        }
+        return out;
+    }
+
+private:
+    std::atomic<std::size_t> _allocations[bin_count]{};
+    std::atomic<std::size_t> _frees[bin_count]{};
+    std::atomic<std::size_t> _lifetimes[lifetime_buckets]{};
+    std::atomic<std::size_t> _current_bytes{ 0 };
+    std::atomic<std::size_t> _peak_bytes{ 0 };
+
+    static std::int64_t _now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+} // namespace my
@@ -0,0 +1,385 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define YAN_HAS_EXECINFO
+#endif
+
+namespace my
+{
+
+// 一组调用栈相同的存活采样。
+struct alloc_sample_stack
+{
+    std::vector<void*> frames;
+    std::size_t samples = 0;
+    std::size_t bytes = 0;           // 被采样的块的字节数之和
+    std::size_t estimated_bytes = 0; // 按采样概率放大后，对这个调用栈上存活字节数的估计
+};
+
+// 抽样分配剖析：只有定义了 YAN_ALLOC_SAMPLE 时 _alloc_proxy 才会使用它。
+// 按字节做泊松抽样：每个线程从指数分布中抽取下一次采样前还需分配的字节数，
+// 每次分配只做一次线程局部的减法，计数耗尽时才记录调用栈。
+// 大小为 s 的块被采中的概率为 1 - exp(-s / interval)，报告时据此放大。
+// 采样的记录用 malloc 分配，不经过 _alloc_proxy。
+class _alloc_sampler
+{
+public:
+    static constexpr std::size_t default_interval = 512 * 1024;
+    static constexpr std::size_t max_depth = 32;
+
+    static _alloc_sampler& get_instance()
+    {
+        // 与中心池一样永不析构。
+        alignas(_alloc_sampler) static std::byte storage[sizeof(_alloc_sampler)];
+        static _alloc_sampler* instance = ::new (storage) _alloc_sampler;
+        return *instance;
+    }
+
+    // 平均每分配多少字节采样一次，0 表示停止采样。
+    // 对调用线程立即生效，其他线程在当前计数耗尽后生效。
+    void set_interval(std::size_t bytes) noexcept;
+
+    std::size_t interval() const noexcept
+    {
+        return _interval.load(std::memory_order_relaxed);
+    }
+
+    // 快速路径只访问线程局部变量与静态的位图，不需要取得实例。
+    static void on_allocate(void* ptr, std::size_t size);
+
+    static void on_deallocate(void* ptr) noexcept
+    {
+        // 所在的桶为空时这块一定没有被采样，绝大多数回收只多读一个位。
+        const std::size_t i = _bucket(ptr);
+        if (_occupied[i / 64].load(std::memory_order_relaxed) & std::uint64_t(1) << i % 64) [[unlikely]]
+        {
+            get_instance()._forget(ptr);
+        }
+    }
+
+    // ptr 指向的块原地从 old_size 扩张到 new_size 字节。已被采样的块按新的大小重新计算权重，
+    // 否则增加的字节照常计入抽样，采中时整块按新的大小记录。
+    static void on_expand(void* ptr, std::size_t old_size, std::size_t new_size);
+
+    // 按调用栈汇总当前存活的采样，按估计字节数从大到小排列。
+    std::vector<alloc_sample_stack> live() const;
+
+    // 以文本输出 live() 的结果，每个调用栈附带符号名（可用时）。
+    std::string report() const;
+
+private:
+    struct _sample
+    {
+        _sample* next;
+        void* ptr;
+        std::size_t size;
+        std::size_t weight;
+        std::size_t interval; // 采样时的间隔，扩张后据此重新计算权重
+        std::size_t depth;
+        void* frames[max_depth];
+    };
+
+    static constexpr std::size_t _bucket_bits = 12;
+
+    static constexpr std::size_t _bucket_count = std::size_t(1) << _bucket_bits;
+
+    // 第 i 位表示第 i 个桶非空，在 _mutex 下修改，回收时不加锁读取。
+    alignas(64) static inline constinit std::atomic<std::uint64_t> _occupied[_bucket_count / 64]{};
+
+    mutable std::mutex _mutex; // 保护各桶的链表
+    std::atomic<std::size_t> _interval{ default_interval };
+    _sample* _buckets[_bucket_count]{};
+
+    _alloc_sampler() = default;
+    _alloc_sampler(const _alloc_sampler&) = delete;
+    _alloc_sampler& operator=(const _alloc_sampler&) = delete;
+
+    static std::size_t _bucket(void* ptr) noexcept
+    {
+        return (reinterpret_cast<std::uintptr_t>(ptr) >> 4) * 0x9e3779b97f4a7c15ull >> (64 - _bucket_bits);
+    }
+
+    // 下一次采样前还需分配的字节数，服从均值为 interval 的指数分布。
+    std::int64_t _next_countdown() noexcept;
+
+    // 对新分配的 counted 字节抽样，采中时把 ptr 指向的 size 字节的块记录下来。
+    static void _sample_bytes(void* ptr, std::size_t counted, std::size_t size);
+
+    // 大小为 size 的块被采中的概率为 1 - exp(-size / interval)，权重为其倒数乘以 size。
+    static std::size_t _weight(std::size_t size, std::size_t interval) noexcept
+    {
+        return static_cast<std::size_t>(static_cast<double>(size) / -std::expm1(-static_cast<double>(size) / static_cast<double>(interval)));
+    }
+
+    void _remember(void* ptr, std::size_t size, std::size_t interval) noexcept
+    {
+        auto* s = static_cast<_sample*>(std::malloc(sizeof(_sample)));
+        if (s == nullptr)
+        {
+            return;
+        }
+        s->ptr = ptr;
+        s->size = size;
+        s->weight = _weight(size, interval);
+        s->interval = interval;
+#if defined(_WIN32)
+        s->depth = CaptureStackBackTrace(1, max_depth, s->frames, nullptr);
+#elif defined(YAN_HAS_EXECINFO)
+        void* frames[max_depth + 1];
+        const int depth = backtrace(frames, max_depth + 1);
+        // 略去本函数自身。
+        s->depth = depth > 1 ? static_cast<std::size_t>(depth - 1) : 0;
+        std::memcpy(s->frames, frames + 1, s->depth * sizeof(void*));
+#else
+        s->depth = 0;
+#endif
+        const std::size_t i = _bucket(ptr);
+        std::lock_guard lock(_mutex);
+        s->next = _buckets[i];
+        _buckets[i] = s;
+        _occupied[i / 64].fetch_or(std::uint64_t(1) << i % 64, std::memory_order_relaxed);
+    }
+
+    // 更新已采样的块的大小，ptr 没有被采样时返回 false。
+    bool _resize(void* ptr, std::size_t size) noexcept
+    {
+        std::lock_guard lock(_mutex);
+        for (_sample* s = _buckets[_bucket(ptr)]; s != nullptr; s = s->next)
+        {
+            if (s->ptr == ptr)
+            {
+                s->size = size;
+                s->weight = _weight(size, s->interval);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void _forget(void* ptr) noexcept
+    {
+        _sample* found = nullptr;
+        {
+            const std::size_t i = _bucket(ptr);
+            std::lock_guard lock(_mutex);
+            for (_sample** link = &_buckets[i]; *link != nullptr; link = &(*link)->next)
+            {
+                if ((*link)->ptr == ptr)
+                {
+                    found = *link;
+                    *link = found->next;
+                    break;
+                }
+            }
+            if (_buckets[i] == nullptr)
+            {
+                _occupied[i / 64].fetch_and(~(std::uint64_t(1) << i % 64), std::memory_order_relaxed);
+            }
+        }
+        std::free(found);
+    }
+};
+
+// 距下一次采样还需分配的字节数。初值为 0，线程的第一次分配即进入慢路径抽取计数。
+inline constinit thread_local std::int64_t _tls_sample_countdown = 0;
+inline constinit thread_local std::uint64_t _tls_sample_seed = 0;
+// 记录调用栈时 backtrace 本身可能分配内存，此时不再采样。
+inline constinit thread_local bool _tls_sampling = false;
+
+// 在作用域内暂停本线程的采样，可以嵌套。
+struct _sampling_pause
+{
+    bool saved = std::exchange(_tls_sampling, true);
+    ~_sampling_pause() { _tls_sampling = saved; }
+};
+
+inline void _alloc_sampler::set_interval(std::size_t bytes) noexcept
+{
+    _interval.store(bytes, std::memory_order_relaxed);
+    _tls_sample_countdown = 0;
+}
+
+inline std::int64_t _alloc_sampler::_next_countdown() noexcept
+{
+    const std::size_t interval = _interval.load(std::memory_order_relaxed);
+    if (interval == 0)
+    {
+        // 停止采样时隔一段时间再检查是否重新开启。
+        return std::int64_t(1) << 30;
+    }
+    std::uint64_t x = _tls_sample_seed;
+    if (x == 0)
+    {
+        x = reinterpret_cast<std::uintptr_t>(&x) ^ 0x2545f4914f6cdd1dull;
+    }
+    // xorshift64，取高 53 位作为 (0, 1] 上的均匀分布。
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    _tls_sample_seed = x;
+    const double u = static_cast<double>((x >> 11) + 1) * 0x1.0p-53;
+    return static_cast<std::int64_t>(-std::log(u) * static_cast<double>(interval)) + 1;
+}
+
+inline void _alloc_sampler::on_allocate(void* ptr, std::size_t size)
+{
+    _sample_bytes(ptr, size, size);
+}
+
+inline void _alloc_sampler::on_expand(void* ptr, std::size_t old_size, std::size_t new_size)
+{
+    const std::size_t i = _bucket(ptr);
+    if (_occupied[i / 64].load(std::memory_order_relaxed) & std::uint64_t(1) << i % 64)
+    {
+        if (get_instance()._resize(ptr, new_size))
+        {
+            return;
+        }
+    }
+    _sample_bytes(ptr, new_size - old_size, new_size);
+}
+
+inline void _alloc_sampler::_sample_bytes(void* ptr, std::size_t counted, std::size_t size)
+{
+    if ((_tls_sample_countdown -= static_cast<std::int64_t>(counted)) > 0) [[likely]]
+    {
+        return;
+    }
+    if (_tls_sampling)
+    {
+        return;
+    }
+    _tls_sampling = true;
+    auto& sampler = get_instance();
+    if (_tls_sample_countdown + static_cast<std::int64_t>(counted) == 0)
+    {
+        // 线程的第一次分配，此前尚未抽取计数。
+        _tls_sample_countdown = sampler._next_countdown() - static_cast<std::int64_t>(counted);
+    }
+    if (_tls_sample_countdown <= 0)
+    {
+        const std::size_t interval = sampler.interval();
+        _tls_sample_countdown = sampler._next_countdown();
+        if (interval != 0)
+        {
+            sampler._remember(ptr, size, interval);
+        }
+    }
+    _tls_sampling = false;
+}
+
+inline std::vector<alloc_sample_stack> _alloc_sampler::live() const
+{
+    // 全局 operator new 替换为 _alloc_proxy 时，构造 vector 会再进入 _remember/_forget，
+    // 因此只在锁内把记录复制到 malloc 的数组中，释放锁后再汇总。
+    _sampling_pause pause;
+    _sample* copies = nullptr;
+    std::size_t count = 0;
+    {
+        std::lock_guard lock(_mutex);
+        for (auto& head : _buckets)
+        {
+            for (_sample* s = head; s != nullptr; s = s->next)
+            {
+                ++count;
+            }
+        }
+        if (count != 0)
+        {
+            copies = static_cast<_sample*>(std::malloc(count * sizeof(_sample)));
+            if (copies == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            std::size_t n = 0;
+            for (auto& head : _buckets)
+            {
+                for (_sample* s = head; s != nullptr; s = s->next)
+                {
+                    copies[n++] = *s;
+                }
+            }
+        }
+    }
+    std::vector<alloc_sample_stack> stacks;
+    try
+    {
+        for (_sample* s = copies; s != copies + count; ++s)
+        {
+            auto it = std::find_if(stacks.begin(), stacks.end(), [s](auto& stack) {
+                return std::equal(stack.frames.begin(), stack.frames.end(), s->frames, s->frames + s->depth);
+            });
+            if (it == stacks.end())
+            {
+                it = stacks.insert(stacks.end(), { std::vector<void*>(s->frames, s->frames + s->depth) });
+            }
+            ++it->samples;
+            it->bytes += s->size;
+            it->estimated_bytes += s->weight;
+        }
+    }
+    catch (...)
+    {
+        std::free(copies);
+        throw;
+    }
+    std::free(copies);
+    std::sort(stacks.begin(), stacks.end(), [](auto& a, auto& b) { return a.estimated_bytes > b.estimated_bytes; });
+    return stacks;
+}
+
+inline std::string _alloc_sampler::report() const
+{
+    _sampling_pause pause;
+    auto stacks = live();
+    std::size_t total = 0;
+    for (auto& stack : stacks)
+    {
+        total += stack.estimated_bytes;
+    }
+    std::string out = std::format("estimated live bytes: {} in {} stacks\n", total, stacks.size());
+    for (auto& stack : stacks)
+    {
+        out += std::format("{} bytes (estimated), {} samples of {} bytes\n", stack.estimated_bytes, stack.samples, stack.bytes);
+#ifdef YAN_HAS_EXECINFO
+        char** symbols = backtrace_symbols(stack.frames.data(), static_cast<int>(stack.frames.size()));
+#endif
+        for (std::size_t i = 0; i < stack.frames.size(); ++i)
+        {
+#ifdef YAN_HAS_EXECINFO
+            if (symbols != nullptr)
+            {
+                out += std::format("    {}\n", symbols[i]);
+                continue;
+            }
+#endif
+            out += std::format("    {}\n", stack.frames[i]);
+        }
+#ifdef YAN_HAS_EXECINFO
+        std::free(symbols);
+#endif
+    }
+    return out;
+}
+
+} // namespace my
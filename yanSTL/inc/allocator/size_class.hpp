@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace my
+{
+
+// 按尺寸分级规则直接计算 n 字节所在级别的编号。
+constexpr std::size_t _size_class_index(std::size_t n) noexcept
+{
+    if (n <= 128)
+    {
+        return n == 0 ? 0 : (n - 1) / 16;
+    }
+    const std::size_t lg = std::bit_width(n - 1);
+    return 8 + (lg - 8) * 4 + ((n - 1) >> (lg - 3)) - 4;
+}
+
+// 小对象的尺寸分级：128 字节以内按 16 字节一级，
+// 其后每翻一倍均分为 4 级（与 jemalloc 相同），所有级别都是 16 的倍数。
+struct _size_class
+{
+    static constexpr std::size_t quantum = 16;
+    static constexpr std::size_t max_small = 32 * 1024; // 不超过该字节数的请求由内存池服务
+
+    // 返回容纳 n 字节的最小级别的编号。
+    static constexpr std::size_t index(std::size_t n) noexcept
+    {
+        if (n <= _lookup_limit)
+        {
+            return _lookup[(n + quantum - 1) / quantum];
+        }
+        return _size_class_index(n);
+    }
+
+    // 返回编号为 i 的级别的字节数。
+    static constexpr std::size_t size(std::size_t i) noexcept
+    {
+        if (i < 8)
+        {
+            return (i + 1) * quantum;
+        }
+        const std::size_t group = (i - 8) / 4;
+        const std::size_t step = (i - 8) % 4 + 1;
+        return (std::size_t(128) << group) + step * (std::size_t(32) << group);
+    }
+
+    // 将 n 向上取整到所在级别的字节数。超过 max_small 时按同样的规则继续分级。
+    static constexpr std::size_t round(std::size_t n) noexcept
+    {
+        if (n <= 128)
+        {
+            return n == 0 ? quantum : (n + quantum - 1) / quantum * quantum;
+        }
+        const std::size_t step = std::bit_floor(n - 1) / 4;
+        return (n + step - 1) / step * step;
+    }
+
+    static constexpr std::size_t count = _size_class_index(max_small) + 1;
+
+    // 返回容纳 n 字节且字节数为 alignment 倍数的最小级别的编号，没有时返回 count。
+    // slab 按自身大小对齐，块从 slab 起始处按级别字节数依次切分，
+    // 因此这样的级别切出的块都按 alignment 对齐。
+    static constexpr std::size_t aligned_index(std::size_t n, std::size_t alignment) noexcept
+    {
+        std::size_t i = index(n);
+        while (i < count && size(i) % alignment != 0)
+        {
+            ++i;
+        }
+        return i;
+    }
+
+private:
+    // 1 KiB 以内用查表代替位运算。
+    static constexpr std::size_t _lookup_limit = 1024;
+    static constexpr auto _lookup = []() {
+        std::array<std::uint8_t, _lookup_limit / quantum + 1> table{};
+        for (std::size_t i = 0; i < table.size(); ++i)
+        {
+            table[i] = static_cast<std::uint8_t>(_size_class_index(i * quantum));
+        }
+        return table;
+    }();
+};
+
+} // namespace my
@@ -0,0 +1,252 @@
+#pragma once
+#include "system.hpp"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace my
+{
+
+// _alloc_proxy 的统计量。
+struct _alloc_stats
+{
+    std::size_t current_allocated_bytes = 0; // 当前已分配未回收的字节数
+    std::size_t total_allocated_bytes = 0;   // 总共已分配的字节数
+    std::size_t current_allocations = 0;     // 尚未回收的分配数
+    std::size_t total_allocations = 0;       // 总共已分配的分配数
+};
+
+// 线程私有的统计分片，独占一条缓存行。
+// 只有所属线程写入，因此用普通的读-改-写即可，不需要带锁前缀的原子指令；
+// 其他线程只在汇总时读取。各计数按 2^64 取模累加，
+// 某线程回收别的线程分配的内存使其分片“变负”时，总和依然正确。
+class alignas(64) _stat_shard
+{
+public:
+    void on_allocate(std::size_t size) noexcept
+    {
+        _bump(_current_bytes, size);
+        _bump(_total_bytes, size);
+        _bump(_current_count, 1);
+        _bump(_total_count, 1);
+    }
+
+    void on_deallocate(std::size_t size) noexcept
+    {
+        _bump(_current_bytes, 0 - size);
+        _bump(_current_count, std::size_t(0) - 1);
+    }
+
+    // 原地扩张，new_size 不小于 old_size，分配数不变。
+    void on_expand(std::size_t old_size, std::size_t new_size) noexcept
+    {
+        _bump(_current_bytes, new_size - old_size);
+        _bump(_total_bytes, new_size - old_size);
+    }
+
+    // 供多个线程共用的分片使用的版本。
+    void on_allocate_shared(std::size_t size) noexcept
+    {
+        _current_bytes.fetch_add(size, std::memory_order_relaxed);
+        _total_bytes.fetch_add(size, std::memory_order_relaxed);
+        _current_count.fetch_add(1, std::memory_order_relaxed);
+        _total_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_deallocate_shared(std::size_t size) noexcept
+    {
+        _current_bytes.fetch_sub(size, std::memory_order_relaxed);
+        _current_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void on_expand_shared(std::size_t old_size, std::size_t new_size) noexcept
+    {
+        _current_bytes.fetch_add(new_size - old_size, std::memory_order_relaxed);
+        _total_bytes.fetch_add(new_size - old_size, std::memory_order_relaxed);
+    }
+
+    void add_to(_alloc_stats& stats) const noexcept
+    {
+        stats.current_allocated_bytes += _current_bytes.load(std::memory_order_relaxed);
+        stats.total_allocated_bytes += _total_bytes.load(std::memory_order_relaxed);
+        stats.current_allocations += _current_count.load(std::memory_order_relaxed);
+        stats.total_allocations += _total_count.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class _stat_registry;
+
+    std::atomic<std::size_t> _current_bytes{ 0 };
+    std::atomic<std::size_t> _total_bytes{ 0 };
+    std::atomic<std::size_t> _current_count{ 0 };
+    std::atomic<std::size_t> _total_count{ 0 };
+    _stat_shard* _next = nullptr;
+    bool _in_use = false;
+
+    static void _bump(std::atomic<std::size_t>& counter, std::size_t delta) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+};
+
+// 登记所有分片。分片从不释放：线程退出后其分片留待新线程复用，
+// 已累计的数值随之保留，汇总结果不受线程进出的影响。
+class _stat_registry
+{
+public:
+    static _stat_registry& get_instance()
+    {
+        // 与中心池一样永不析构。
+        alignas(_stat_registry) static std::byte storage[sizeof(_stat_registry)];
+        static _stat_registry* instance = ::new (storage) _stat_registry;
+        return *instance;
+    }
+
+    _stat_shard* acquire()
+    {
+        std::lock_guard lock(_mutex);
+        for (_stat_shard* shard = _shards; shard != nullptr; shard = shard->_next)
+        {
+            if (!shard->_in_use)
+            {
+                shard->_in_use = true;
+                return shard;
+            }
+        }
+        auto* shard = _system_heap::create<_stat_shard>();
+        shard->_in_use = true;
+        shard->_next = _shards;
+        _shards = shard;
+        return shard;
+    }
+
+    void release(_stat_shard* shard) noexcept
+    {
+        std::lock_guard lock(_mutex);
+        shard->_in_use = false;
+    }
+
+    // 线程退出后仍发生的分配与回收记在这个共用分片上。
+    _stat_shard& shared() noexcept
+    {
+        return _shared;
+    }
+
+    // 汇总所有分片，减去上次 rebase 时的基线。
+    _alloc_stats snapshot() const
+    {
+        std::lock_guard lock(_mutex);
+        _alloc_stats stats = _sum();
+        stats.current_allocated_bytes -= _baseline.current_allocated_bytes;
+        stats.total_allocated_bytes -= _baseline.total_allocated_bytes;
+        stats.current_allocations -= _baseline.current_allocations;
+        stats.total_allocations -= _baseline.total_allocations;
+        return stats;
+    }
+
+    // 以当前总和为新的基线，相当于将所有统计量清零。
+    void rebase()
+    {
+        std::lock_guard lock(_mutex);
+        _baseline = _sum();
+    }
+
+private:
+    mutable std::mutex _mutex;
+    _stat_shard* _shards = nullptr;
+    _stat_shard _shared;
+    _alloc_stats _baseline;
+
+    _alloc_stats _sum() const noexcept
+    {
+        _alloc_stats stats;
+        _shared.add_to(stats);
+        for (const _stat_shard* shard = _shards; shard != nullptr; shard = shard->_next)
+        {
+            shard->add_to(stats);
+        }
+        return stats;
+    }
+
+    _stat_registry() = default;
+    _stat_registry(const _stat_registry&) = delete;
+    _stat_registry& operator=(const _stat_registry&) = delete;
+};
+
+inline constinit thread_local _stat_shard* _tls_stat_shard = nullptr;
+inline constinit thread_local bool _tls_stat_retired = false;
+
+// 线程退出时交还分片。
+struct _stat_shard_reaper
+{
+    ~_stat_shard_reaper()
+    {
+        _stat_registry::get_instance().release(_tls_stat_shard);
+        _tls_stat_shard = nullptr;
+        _tls_stat_retired = true;
+    }
+};
+
+// 返回当前线程的分片；线程已退出时返回空指针，调用者改用共用分片。
+inline _stat_shard* _acquire_stat_shard()
+{
+    if (_tls_stat_retired)
+    {
+        return nullptr;
+    }
+    thread_local _stat_shard_reaper reaper;
+    (void)reaper;
+    _tls_stat_shard = _stat_registry::get_instance().acquire();
+    return _tls_stat_shard;
+}
+
+inline void _record_allocate(std::size_t size)
+{
+    if (_stat_shard* shard = _tls_stat_shard) [[likely]]
+    {
+        shard->on_allocate(size);
+    }
+    else if (_stat_shard* shard = _acquire_stat_shard())
+    {
+        shard->on_allocate(size);
+    }
+    else
+    {
+        _stat_registry::get_instance().shared().on_allocate_shared(size);
+    }
+}
+
+inline void _record_deallocate(std::size_t size)
+{
+    if (_stat_shard* shard = _tls_stat_shard) [[likely]]
+    {
+        shard->on_deallocate(size);
+    }
+    else if (_stat_shard* shard = _acquire_stat_shard())
+    {
+        shard->on_deallocate(size);
+    }
+    else
+    {
+        _stat_registry::get_instance().shared().on_deallocate_shared(size);
+    }
+}
+
+inline void _record_expand(std::size_t old_size, std::size_t new_size)
+{
+    if (_stat_shard* shard = _tls_stat_shard) [[likely]]
+    {
+        shard->on_expand(old_size, new_size);
+    }
+    else if (_stat_shard* shard = _acquire_stat_shard())
+    {
+        shard->on_expand(old_size, new_size);
+    }
+    else
+    {
+        _stat_registry::get_instance().shared().on_expand_shared(old_size, new_size);
+    }
+}
+
+} // namespace my
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace my
+{
+
+// 分配器自身的内存直接取自 C 运行库的堆，不经过 ::operator new：
+// 全局 operator new 被替换为 _alloc_proxy 时（见 yanSTL/src/yan_new.cpp），
+// 经由它分配会递归回到分配器自身。
+struct _system_heap
+{
+    static void* allocate(std::size_t size)
+    {
+        void* ptr = std::malloc(size == 0 ? 1 : size);
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void deallocate(void* ptr) noexcept
+    {
+        std::free(ptr);
+    }
+
+    // alignment 须为 2 的幂。
+    static void* allocate(std::size_t size, std::size_t alignment)
+    {
+        if (alignment <= alignof(std::max_align_t))
+        {
+            return allocate(size);
+        }
+#if defined(_WIN32)
+        void* ptr = ::_aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+        // aligned_alloc 要求字节数是对齐字节数的倍数。
+        const std::size_t bytes = (size + alignment - 1) & ~(alignment - 1);
+        void* ptr = bytes < size ? nullptr : std::aligned_alloc(alignment, bytes == 0 ? alignment : bytes);
+#endif
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void deallocate(void* ptr, std::size_t alignment) noexcept
+    {
+#if defined(_WIN32)
+        if (alignment > alignof(std::max_align_t))
+        {
+            ::_aligned_free(ptr);
+            return;
+        }
+#else
+        (void)alignment;
+#endif
+        std::free(ptr);
+    }
+
+    // 在系统堆上构造 T，用于分配器内部的簿记对象。
+    template <typename T>
+    static T* create()
+    {
+        return ::new (allocate(sizeof(T), alignof(T))) T;
+    }
+};
+
+} // namespace my
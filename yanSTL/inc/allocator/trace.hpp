@@ -0,0 +1,294 @@
+#pragma once
+#include "system.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace my
+{
+
+// 分配追踪文件中的一条记录。文件以 alloc_trace_header 开头，其后依次是记录，均为本机字节序。
+struct alloc_trace_record
+{
+    static constexpr std::uint64_t size_mask = (std::uint64_t(1) << 48) - 1;
+
+    std::uint64_t timestamp; // 自开始追踪起的纳秒数
+    std::uint64_t id;        // 内存块的地址，用于配对同一块的分配与回收
+    std::uint64_t packed;    // 低 48 位为字节数，其上 15 位为线程编号，最高位表示回收
+                             // 线程编号从 1 起循环使用，0 表示线程退出后的分配
+
+    std::uint64_t size() const noexcept { return packed & size_mask; }
+    std::uint32_t thread() const noexcept { return static_cast<std::uint32_t>(packed >> 48) & 0x7fff; }
+    bool is_deallocate() const noexcept { return (packed >> 63) != 0; }
+};
+
+struct alloc_trace_header
+{
+    static constexpr char expected_magic[8] = { 'Y', 'A', 'N', 'T', 'R', 'A', 'C', 'E' };
+    static constexpr std::uint32_t current_version = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+};
+
+// 读取追踪文件。文件不存在或格式不符时返回空。
+inline std::vector<alloc_trace_record> load_alloc_trace(const char* path)
+{
+    std::vector<alloc_trace_record> records;
+    std::FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return records;
+    }
+    alloc_trace_header header;
+    if (std::fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.magic, alloc_trace_header::expected_magic, sizeof(header.magic)) == 0
+        && header.version == alloc_trace_header::current_version
+        && header.record_size == sizeof(alloc_trace_record))
+    {
+        alloc_trace_record buffer[1024];
+        while (const std::size_t n = std::fread(buffer, sizeof(alloc_trace_record), std::size(buffer), file))
+        {
+            records.insert(records.end(), buffer, buffer + n);
+        }
+    }
+    std::fclose(file);
+    return records;
+}
+
+// 线程私有的记录缓冲区，满了才加锁写入文件。
+// 与统计分片一样从不释放，线程退出后留待新线程复用。
+struct _trace_buffer
+{
+    static constexpr std::size_t capacity = 1024;
+
+    std::mutex mutex; // 只在 stop 时与其他线程争用
+    std::size_t count = 0;
+    std::uint64_t thread = 0;
+    _trace_buffer* next = nullptr;
+    bool in_use = false;
+    alloc_trace_record records[capacity];
+};
+
+// 分配追踪：只有定义了 YAN_ALLOC_TRACE 时 _alloc_proxy 才会使用它，
+// 运行时以 start/stop 开关，未开始时每次分配只多一次原子读。
+class _alloc_tracer
+{
+public:
+    static _alloc_tracer& get_instance()
+    {
+        // 与中心池一样永不析构。
+        alignas(_alloc_tracer) static std::byte storage[sizeof(_alloc_tracer)];
+        static _alloc_tracer* instance = ::new (storage) _alloc_tracer;
+        return *instance;
+    }
+
+    // 开始把记录写入 path。文件无法打开或已在追踪时返回 false。
+    bool start(const char* path)
+    {
+        std::lock_guard lock(_mutex);
+        if (_file != nullptr)
+        {
+            return false;
+        }
+        _file = std::fopen(path, "wb");
+        if (_file == nullptr)
+        {
+            return false;
+        }
+        alloc_trace_header header{ {}, alloc_trace_header::current_version, sizeof(alloc_trace_record) };
+        std::memcpy(header.magic, alloc_trace_header::expected_magic, sizeof(header.magic));
+        std::fwrite(&header, sizeof(header), 1, _file);
+        for (_trace_buffer* buffer = _buffers; buffer != nullptr; buffer = buffer->next)
+        {
+            std::lock_guard buffer_lock(buffer->mutex);
+            buffer->count = 0;
+        }
+        {
+            // 共用缓冲区不在链表中，上一次追踪遗留的记录也要清掉
+            std::lock_guard shared_lock(_shared.mutex);
+            _shared.count = 0;
+        }
+        _start_time = _now();
+        _running.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // 停止追踪，写出所有线程缓冲区中的记录并关闭文件。
+    void stop()
+    {
+        std::lock_guard lock(_mutex);
+        if (_file == nullptr)
+        {
+            return;
+        }
+        _running.store(false, std::memory_order_release);
+        for (_trace_buffer* buffer = _buffers; buffer != nullptr; buffer = buffer->next)
+        {
+            std::lock_guard buffer_lock(buffer->mutex);
+            _write(*buffer);
+        }
+        {
+            std::lock_guard shared_lock(_shared.mutex);
+            _write(_shared);
+        }
+        std::fclose(_file);
+        _file = nullptr;
+    }
+
+    bool running() const noexcept
+    {
+        return _running.load(std::memory_order_relaxed);
+    }
+
+    void on_allocate(void* ptr, std::size_t size)
+    {
+        if (_running.load(std::memory_order_acquire)) [[unlikely]]
+        {
+            _record(ptr, size, 0);
+        }
+    }
+
+    void on_deallocate(void* ptr, std::size_t size)
+    {
+        if (_running.load(std::memory_order_acquire)) [[unlikely]]
+        {
+            _record(ptr, size, std::uint64_t(1) << 63);
+        }
+    }
+
+    _trace_buffer* acquire()
+    {
+        std::lock_guard lock(_mutex);
+        for (_trace_buffer* buffer = _buffers; buffer != nullptr; buffer = buffer->next)
+        {
+            if (!buffer->in_use)
+            {
+                buffer->in_use = true;
+                buffer->thread = _next_thread();
+                return buffer;
+            }
+        }
+        auto* buffer = _system_heap::create<_trace_buffer>();
+        buffer->in_use = true;
+        buffer->thread = _next_thread();
+        buffer->next = _buffers;
+        _buffers = buffer;
+        return buffer;
+    }
+
+    // 线程退出时写出其记录并交还缓冲区。
+    void release(_trace_buffer* buffer)
+    {
+        std::lock_guard lock(_mutex);
+        std::lock_guard buffer_lock(buffer->mutex);
+        _write(*buffer);
+        buffer->in_use = false;
+    }
+
+private:
+    std::mutex _mutex; // 保护 _file 与缓冲区链表
+    std::atomic<bool> _running{ false };
+    std::FILE* _file = nullptr;
+    std::uint64_t _start_time = 0;
+    _trace_buffer* _buffers = nullptr;
+    std::uint64_t _thread_count = 0;
+    _trace_buffer _shared; // 线程退出后仍发生的分配记在这里
+
+    _alloc_tracer() = default;
+
+    // 每次取得缓冲区都分配新的线程编号，复用的缓冲区也不沿用上一个线程的编号。
+    // 编号在 1 到 0x7fff 间循环，0 留给共用缓冲区。调用方持有 _mutex。
+    std::uint64_t _next_thread() noexcept
+    {
+        return 1 + _thread_count++ % 0x7fff;
+    }
+    _alloc_tracer(const _alloc_tracer&) = delete;
+    _alloc_tracer& operator=(const _alloc_tracer&) = delete;
+
+    static std::uint64_t _now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void _record(void* ptr, std::size_t size, std::uint64_t op);
+
+    // 调用者持有 _mutex 与 buffer.mutex。
+    void _write(_trace_buffer& buffer) noexcept
+    {
+        if (_file != nullptr && buffer.count != 0)
+        {
+            std::fwrite(buffer.records, sizeof(alloc_trace_record), buffer.count, _file);
+        }
+        buffer.count = 0;
+    }
+
+    // 缓冲区满时写出，先取文件锁再取缓冲区锁，与 stop 的加锁顺序一致。
+    void _flush(_trace_buffer& buffer) noexcept
+    {
+        std::lock_guard lock(_mutex);
+        std::lock_guard buffer_lock(buffer.mutex);
+        if (buffer.count == _trace_buffer::capacity)
+        {
+            _write(buffer);
+        }
+    }
+};
+
+inline constinit thread_local _trace_buffer* _tls_trace_buffer = nullptr;
+inline constinit thread_local bool _tls_trace_retired = false;
+
+struct _trace_buffer_reaper
+{
+    ~_trace_buffer_reaper()
+    {
+        _alloc_tracer::get_instance().release(_tls_trace_buffer);
+        _tls_trace_buffer = nullptr;
+        _tls_trace_retired = true;
+    }
+};
+
+inline void _alloc_tracer::_record(void* ptr, std::size_t size, std::uint64_t op)
+{
+    _trace_buffer* buffer = _tls_trace_buffer;
+    if (buffer == nullptr)
+    {
+        if (_tls_trace_retired)
+        {
+            buffer = &_shared;
+        }
+        else
+        {
+            thread_local _trace_buffer_reaper reaper;
+            (void)reaper;
+            buffer = _tls_trace_buffer = acquire();
+        }
+    }
+    const alloc_trace_record record{
+        _now() - _start_time,
+        reinterpret_cast<std::uintptr_t>(ptr),
+        (std::uint64_t(size) & alloc_trace_record::size_mask) | buffer->thread << 48 | op
+    };
+    for (;;)
+    {
+        {
+            std::lock_guard lock(buffer->mutex);
+            if (buffer->count != _trace_buffer::capacity)
+            {
+                buffer->records[buffer->count++] = record;
+                return;
+            }
+        }
+        _flush(*buffer);
+    }
+}
+
+} // namespace my
@@ -0,0 +1,193 @@
+#pragma once
+#include "../yan_allocator.hpp"
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace my
+{
+
+// 主流标准库的智能指针同样只持有指针，可以平凡搬移。
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<std::unique_ptr<T>> = true;
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<std::shared_ptr<T>> = true;
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<std::weak_ptr<T>> = true;
+
+// 仅当 allocator_traits<Alloc>::construct(a, p, args...) 最终调用 std::construct_at 时返回真，
+// 此时可以用 memcpy 代替逐个构造。
+template <typename Alloc, typename T, typename... Args>
+inline constexpr bool _alloc_default_construct_v = !requires(Alloc& a, T* p, Args&&... args) { a.construct(p, std::forward<Args>(args)...); };
+
+template <typename Alloc, typename T>
+inline constexpr bool _alloc_default_destroy_v = !requires(Alloc& a, T* p) { a.destroy(p); };
+
+// 源与目的都是 T 的连续存储，且构造不经过分配器的定制 construct。
+template <typename Alloc, typename It, typename T, typename Arg>
+inline constexpr bool _memcpy_constructible_v =
+    std::contiguous_iterator<It>
+    && std::is_same_v<std::remove_cv_t<std::iter_value_t<It>>, T>
+    && std::is_trivially_copyable_v<T>
+    && _alloc_default_construct_v<Alloc, T, Arg>;
+
+// 出错时销毁 [first, *cursor) 上已构造的元素。
+template <typename Alloc, typename T>
+struct _uninitialized_guard
+{
+    Alloc& alloc;
+    T* first;
+    T*& cursor;
+    bool done = false;
+
+    ~_uninitialized_guard()
+    {
+        if (!done)
+        {
+            for (T* p = first; p != cursor; ++p)
+            {
+                allocator_traits<Alloc>::destroy(alloc, p);
+            }
+        }
+    }
+};
+
+// 经由 allocator_traits<Alloc>::construct 在 dest 起始的未初始化存储上复制构造 [first, last)，
+// 返回目的范围的尾后。构造抛出异常时销毁已构造的元素并重新抛出。
+// 源是 T 的连续存储、T 可平凡复制且分配器没有定制 construct 时只做一次 memcpy。
+template <typename Alloc, typename InputIt, typename T>
+T* uninitialized_copy(Alloc& alloc, InputIt first, InputIt last, T* dest)
+{
+    if constexpr (_memcpy_constructible_v<Alloc, InputIt, T, const T&>)
+    {
+        const auto n = static_cast<size_t>(last - first);
+        if (n != 0)
+        {
+            std::memcpy(dest, std::to_address(first), n * sizeof(T));
+        }
+        return dest + n;
+    }
+    else
+    {
+        T* cursor = dest;
+        _uninitialized_guard<Alloc, T> guard{ alloc, dest, cursor };
+        for (; first != last; ++first, ++cursor)
+        {
+            allocator_traits<Alloc>::construct(alloc, cursor, *first);
+        }
+        guard.done = true;
+        return cursor;
+    }
+}
+
+// 同 uninitialized_copy，但以移动构造代替复制构造。源元素保留在被移动后的状态。
+template <typename Alloc, typename InputIt, typename T>
+T* uninitialized_move(Alloc& alloc, InputIt first, InputIt last, T* dest)
+{
+    if constexpr (_memcpy_constructible_v<Alloc, InputIt, T, T&&>)
+    {
+        const auto n = static_cast<size_t>(last - first);
+        if (n != 0)
+        {
+            std::memcpy(dest, std::to_address(first), n * sizeof(T));
+        }
+        return dest + n;
+    }
+    else
+    {
+        T* cursor = dest;
+        _uninitialized_guard<Alloc, T> guard{ alloc, dest, cursor };
+        for (; first != last; ++first, ++cursor)
+        {
+            allocator_traits<Alloc>::construct(alloc, cursor, std::move(*first));
+        }
+        guard.done = true;
+        return cursor;
+    }
+}
+
+// 把 [first, last) 上的元素搬到 dest 起始的未初始化存储，并销毁源元素，返回目的范围的尾后。
+// T 可平凡搬移且分配器没有定制 construct/destroy 时只做一次 memmove；
+// 否则逐个移动构造并销毁源元素。移动构造可能抛出异常时先全部移动、成功后再销毁源，
+// 出错时源范围保持完整。
+// 用于扩容与原地压缩：两个范围可以重叠，但要求 dest <= first；
+// dest == first 时元素已在原位，什么都不做。移动构造可能抛出异常的类型不支持重叠。
+template <typename Alloc, typename T>
+T* uninitialized_relocate(Alloc& alloc, T* first, T* last, T* dest)
+{
+    if (dest == first)
+    {
+        return last;
+    }
+    if constexpr (is_trivially_relocatable_v<T> && _alloc_default_construct_v<Alloc, T, T&&> && _alloc_default_destroy_v<Alloc, T>)
+    {
+        const auto n = static_cast<size_t>(last - first);
+        if (n != 0)
+        {
+            std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T));
+        }
+        return dest + n;
+    }
+    else if constexpr (std::is_nothrow_move_constructible_v<T>)
+    {
+        for (; first != last; ++first, ++dest)
+        {
+            allocator_traits<Alloc>::construct(alloc, dest, std::move(*first));
+            allocator_traits<Alloc>::destroy(alloc, first);
+        }
+        return dest;
+    }
+    else
+    {
+        T* end = my::uninitialized_move(alloc, first, last, dest);
+        for (; first != last; ++first)
+        {
+            allocator_traits<Alloc>::destroy(alloc, first);
+        }
+        return end;
+    }
+}
+
+// 把可容纳 capacity 个元素、前 size 个已构造的存储空间扩大到可容纳 new_capacity 个元素，返回新的地址。
+// 先尝试原地扩张，此时元素不动；T 可平凡搬移且分配器提供 reallocate 时交给它整体搬移
+// （my::allocator 对大块内存只改写页表）；否则分配新的存储空间，
+// 用 uninitialized_relocate 搬移元素并回收旧的。分配或搬移抛出异常时原存储空间保持不变。
+template <typename Alloc, typename T>
+T* reallocate(Alloc& alloc, T* p, size_t size, size_t capacity, size_t new_capacity)
+{
+    using traits = allocator_traits<Alloc>;
+    if (p != nullptr && traits::try_expand(alloc, p, capacity, new_capacity))
+    {
+        return p;
+    }
+    if constexpr (is_trivially_relocatable_v<T> && _alloc_default_construct_v<Alloc, T, T&&> && _alloc_default_destroy_v<Alloc, T>
+        && requires { alloc.reallocate(p, capacity, new_capacity); })
+    {
+        if (p != nullptr)
+        {
+            return alloc.reallocate(p, capacity, new_capacity);
+        }
+    }
+    T* fresh = traits::allocate(alloc, new_capacity);
+    if (p == nullptr)
+    {
+        return fresh;
+    }
+    try
+    {
+        my::uninitialized_relocate(alloc, p, p + size, fresh);
+    }
+    catch (...)
+    {
+        traits::deallocate(alloc, fresh, new_capacity);
+        throw;
+    }
+    traits::deallocate(alloc, p, capacity);
+    return fresh;
+}
+
+} // namespace my
@@ -0,0 +1,227 @@
+#pragma once
+#include "shared_ptr.hpp"
+#include <atomic>
+#include <cstdint>
+
+namespace my {
+
+// 目前只为 shared_ptr 与 weak_ptr 提供特化，其余类型请使用 std::atomic。
+template <typename T>
+class atomic;
+
+// atomic<shared_ptr<T>> 与 atomic<weak_ptr<T>> 的公共实现，采用分离引用计数。
+// 每次 store 把值的副本放进一个节点，原子变量只是一个 64 位的字：
+// 低位是节点的地址，高位是正在读取这个节点的线程数（外部计数）。
+// 读取者先对字做一次原子加法登记自己，复制节点中的值，再减去登记；
+// 若这期间节点已被替换，改为递减节点自身的内部计数。
+// 替换节点的线程把被替换时的外部计数加进内部计数，内部计数归零时节点由最后一个离开者释放。
+// 读写都只对同一个字做无锁的读-改-写，没有互斥锁，也不自旋等待其他线程。
+template <typename P>
+class _atomic_smart_ptr {
+public:
+    static constexpr bool is_always_lock_free = std::atomic<std::uint64_t>::is_always_lock_free;
+
+    constexpr _atomic_smart_ptr() noexcept = default;
+    _atomic_smart_ptr(P desired) : word_(_pack(_make_node(std::move(desired)), 0)) {}
+    _atomic_smart_ptr(const _atomic_smart_ptr&) = delete;
+    _atomic_smart_ptr& operator=(const _atomic_smart_ptr&) = delete;
+
+    ~_atomic_smart_ptr() {
+        // 析构时不应再有其他线程访问。
+        _destroy_node(_node_of(word_.load(std::memory_order_relaxed)));
+    }
+
+    bool is_lock_free() const noexcept {
+        return word_.is_lock_free();
+    }
+
+    // memory_order 参数只为与 std::atomic 的接口一致，所有操作都是对同一个字的读-改-写，
+    // 因而总是按 acq_rel 同步，且同一对象上的操作有全序。
+    P load(std::memory_order = std::memory_order_seq_cst) const {
+        _node* node = _acquire();
+        if (node == nullptr) {
+            return P();
+        }
+        P value(node->value);
+        _release(node);
+        return value;
+    }
+
+    operator P() const {
+        return load();
+    }
+
+    void store(P desired, std::memory_order = std::memory_order_seq_cst) {
+        _retire(word_.exchange(_pack(_make_node(std::move(desired)), 0), std::memory_order_acq_rel), 0);
+    }
+
+    void operator=(P desired) {
+        store(std::move(desired));
+    }
+
+    P exchange(P desired, std::memory_order = std::memory_order_seq_cst) {
+        const std::uint64_t old = word_.exchange(_pack(_make_node(std::move(desired)), 0), std::memory_order_acq_rel);
+        _node* node = _node_of(old);
+        if (node == nullptr) {
+            return P();
+        }
+        // 其他线程可能仍在复制这个节点的值，只能复制而不能移出。
+        P value(node->value);
+        _retire(old, 0);
+        return value;
+    }
+
+    // 当前值与 expected 的指针和控制块都相同时替换为 desired 并返回 true；
+    // 否则把当前值写入 expected 并返回 false。不会虚假失败。
+    bool compare_exchange_strong(P& expected, P desired, std::memory_order = std::memory_order_seq_cst) {
+        _node* fresh = nullptr;
+        for (;;) {
+            _node* node = _acquire();
+            const bool equal = node == nullptr ? _empty(expected) : _same(node->value, expected);
+            if (!equal) {
+                expected = node == nullptr ? P() : node->value;
+                if (node != nullptr) {
+                    _release(node);
+                }
+                _destroy_node(fresh);
+                return false;
+            }
+            if (fresh == nullptr && !_empty(desired)) {
+                fresh = _make_node(std::move(desired));
+            }
+            // 登记后计数只会被其他读取者改变，节点不变就重试。
+            std::uint64_t current = word_.load(std::memory_order_relaxed);
+            while (_node_of(current) == node) {
+                if (word_.compare_exchange_weak(current, _pack(fresh, 0), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    // 外部计数中包含自己的登记。
+                    if (node != nullptr) {
+                        _retire(current, 1);
+                    }
+                    return true;
+                }
+            }
+            if (node != nullptr) {
+                _release(node);
+            }
+        }
+    }
+
+    bool compare_exchange_strong(P& expected, P desired, std::memory_order, std::memory_order) {
+        return compare_exchange_strong(expected, std::move(desired));
+    }
+
+    bool compare_exchange_weak(P& expected, P desired, std::memory_order = std::memory_order_seq_cst) {
+        return compare_exchange_strong(expected, std::move(desired));
+    }
+
+    bool compare_exchange_weak(P& expected, P desired, std::memory_order, std::memory_order) {
+        return compare_exchange_strong(expected, std::move(desired));
+    }
+
+private:
+    struct _node {
+        P value;
+        std::atomic<std::intptr_t> internal{ 0 };
+    };
+
+    using _node_allocator = allocator<_node>;
+
+    // 64 位指针中只有低 48 位有效，32 位平台则以高 32 位计数。
+    static constexpr unsigned _count_shift = sizeof(void*) == 8 ? 48 : 32;
+    static constexpr std::uint64_t _count_one = std::uint64_t(1) << _count_shift;
+    static constexpr std::uint64_t _pointer_mask = _count_one - 1;
+
+    mutable std::atomic<std::uint64_t> word_{ 0 };
+
+    static std::uint64_t _pack(_node* node, std::uint64_t count) noexcept {
+        return reinterpret_cast<std::uintptr_t>(node) | count << _count_shift;
+    }
+
+    static _node* _node_of(std::uint64_t word) noexcept {
+        return reinterpret_cast<_node*>(static_cast<std::uintptr_t>(word & _pointer_mask));
+    }
+
+    static _node* _make_node(P value) {
+        if (_empty(value)) {
+            return nullptr;
+        }
+        _node_allocator alloc;
+        _node* node = alloc.allocate(1);
+        ::new (static_cast<void*>(node)) _node{ std::move(value) };
+        return node;
+    }
+
+    static void _destroy_node(_node* node) noexcept {
+        if (node != nullptr) {
+            node->~_node();
+            _node_allocator().deallocate(node, 1);
+        }
+    }
+
+    static bool _empty(const P& p) noexcept {
+        return p.ptr_ == nullptr && p.cb_ == nullptr;
+    }
+
+    static bool _same(const P& a, const P& b) noexcept {
+        return a.ptr_ == b.ptr_ && a.cb_ == b.cb_;
+    }
+
+    // 登记为当前节点的读取者，返回该节点。
+    _node* _acquire() const noexcept {
+        std::uint64_t current = word_.load(std::memory_order_relaxed);
+        while (_node_of(current) != nullptr
+            && !word_.compare_exchange_weak(current, current + _count_one, std::memory_order_acquire, std::memory_order_relaxed)) {
+        }
+        return _node_of(current);
+    }
+
+    // 撤销登记；节点已被替换时改为递减内部计数。
+    void _release(_node* node) const noexcept {
+        std::uint64_t current = word_.load(std::memory_order_relaxed);
+        while (_node_of(current) == node) {
+            if (word_.compare_exchange_weak(current, current - _count_one, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        if (node->internal.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _destroy_node(node);
+        }
+    }
+
+    // 节点 old 已被替换，把外部计数（减去调用者自己的 self 次登记）转入内部计数。
+    static void _retire(std::uint64_t old, std::intptr_t self) noexcept {
+        _node* node = _node_of(old);
+        if (node == nullptr) {
+            return;
+        }
+        const std::intptr_t pending = static_cast<std::intptr_t>(old >> _count_shift) - self;
+        if (node->internal.fetch_add(pending, std::memory_order_acq_rel) + pending == 0) {
+            _destroy_node(node);
+        }
+    }
+};
+
+template <typename T>
+class atomic<shared_ptr<T>> : public _atomic_smart_ptr<shared_ptr<T>> {
+    using Base = _atomic_smart_ptr<shared_ptr<T>>;
+public:
+    using value_type = shared_ptr<T>;
+    using Base::Base;
+    using Base::operator=;
+
+    constexpr atomic() noexcept = default;
+    constexpr atomic(std::nullptr_t) noexcept {}
+};
+
+template <typename T>
+class atomic<weak_ptr<T>> : public _atomic_smart_ptr<weak_ptr<T>> {
+    using Base = _atomic_smart_ptr<weak_ptr<T>>;
+public:
+    using value_type = weak_ptr<T>;
+    using Base::Base;
+    using Base::operator=;
+
+    constexpr atomic() noexcept = default;
+};
+
+} // namespace my
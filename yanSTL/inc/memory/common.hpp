@@ -3,6 +3,7 @@
 #include <utility>
 #include <atomic>
 #include <stdexcept>
+#include "../yan_type_traits.hpp"
 
 namespace my {
 
@@ -11,10 +12,23 @@ template <typename T, typename Deleter = std::default_delete<T>>
 class unique_ptr;
 
 template <typename T, typename... Args>
+    requires (!std::is_array_v<T>)
 unique_ptr<T> make_unique(Args&&... args);
 
 template <typename T>
-unique_ptr<T[]> make_unique(size_t size);
+    requires std::is_unbounded_array_v<T>
+unique_ptr<T> make_unique(size_t size);
+
+template <typename T>
+    requires (!std::is_array_v<T>)
+unique_ptr<T> make_unique_for_overwrite();
+
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+unique_ptr<T> make_unique_for_overwrite(size_t size);
+
+template <typename T, typename Alloc>
+class allocator_delete;
 #endif
 
 #ifndef DISMISS_SHARED_AND_WEAK_PTR
@@ -22,10 +36,22 @@ template <typename T>
 class shared_ptr;
 
 template <typename T, typename... Args>
+    requires (!std::is_array_v<T>)
 shared_ptr<T> make_shared(Args&&... args);
 
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> make_shared(size_t n);
+
+template <typename T>
+    requires std::is_bounded_array_v<T>
+shared_ptr<T> make_shared();
+
 template <typename T>
 class weak_ptr;
+
+template <typename T>
+class local_shared_ptr;
 #endif
 
 #ifndef DISMISS_ENABLE_SHARED_FROM_THIS
@@ -33,6 +59,63 @@ template <typename T>
 class enable_shared_from_this;
 #endif
 
+template <typename T>
+class intrusive_ptr;
+
+
+// 第二个成员为空类且可被继承时以空基类优化存放，不占空间。
+// 以成员的形式使用，空类的成员函数因此不会混入外层的类。
+template <typename First, typename Second, bool = std::is_empty_v<Second> && !std::is_final_v<Second>>
+class _compressed_pair : private Second {
+public:
+    template <typename... Args>
+    constexpr _compressed_pair(First first, Args&&... args)
+        : Second(std::forward<Args>(args)...), first_(first) {}
+
+    constexpr First& first() noexcept { return first_; }
+    constexpr const First& first() const noexcept { return first_; }
+    constexpr Second& second() noexcept { return *this; }
+    constexpr const Second& second() const noexcept { return *this; }
+
+private:
+    First first_;
+};
 
+template <typename First, typename Second>
+class _compressed_pair<First, Second, false> {
+public:
+    template <typename... Args>
+    constexpr _compressed_pair(First first, Args&&... args)
+        : first_(first), second_(std::forward<Args>(args)...) {}
+
+    constexpr First& first() noexcept { return first_; }
+    constexpr const First& first() const noexcept { return first_; }
+    constexpr Second& second() noexcept { return second_; }
+    constexpr const Second& second() const noexcept { return second_; }
+
+private:
+    First first_;
+    Second second_;
+};
+
+// 智能指针只持有指针（与可平凡搬移的删除器），搬到新地址后原对象无需析构。
+#ifndef DISMISS_UNIQUE_PTR
+template <typename T, typename Deleter>
+inline constexpr bool is_trivially_relocatable_v<unique_ptr<T, Deleter>> = is_trivially_relocatable_v<Deleter>;
+#endif
+
+#ifndef DISMISS_SHARED_AND_WEAK_PTR
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<shared_ptr<T>> = true;
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<weak_ptr<T>> = true;
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<local_shared_ptr<T>> = true;
+#endif
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v<intrusive_ptr<T>> = true;
 
 } // namespace my
\ No newline at end of file
@@ -0,0 +1,201 @@
+#pragma once
+#include "common.hpp"
+#ifndef DISMISS_UNIQUE_PTR
+#include "unique_ptr.hpp"
+#endif
+#include <atomic>
+#include <compare>
+
+namespace my {
+
+// intrusive_ref_counter 的计数策略：可被多个线程同时增减的原子计数。
+struct thread_safe_counter {
+    using type = std::atomic<size_t>;
+
+    static size_t load(const type& count) noexcept {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    static void increment(type& count) noexcept {
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 返回递减后的值；归零时之前所有线程对对象的写入都已可见。
+    static size_t decrement(type& count) noexcept {
+        return count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    }
+};
+
+// 只在单个线程内使用的普通整数计数。
+struct thread_unsafe_counter {
+    using type = size_t;
+
+    static size_t load(const type& count) noexcept {
+        return count;
+    }
+
+    static void increment(type& count) noexcept {
+        ++count;
+    }
+
+    static size_t decrement(type& count) noexcept {
+        return --count;
+    }
+};
+
+// 把引用计数嵌入对象的基类，T 为派生类自身。计数归零时以 delete 删除对象，
+// 因此对象须由 new（或 make_intrusive、make_unique）创建。
+// 复制对象时不复制计数：副本是一个尚无人引用的新对象。
+template <typename T, typename Policy = thread_safe_counter>
+class intrusive_ref_counter {
+public:
+    size_t use_count() const noexcept {
+        return Policy::load(count_);
+    }
+
+protected:
+    intrusive_ref_counter() noexcept = default;
+    intrusive_ref_counter(const intrusive_ref_counter&) noexcept {}
+    intrusive_ref_counter& operator=(const intrusive_ref_counter&) noexcept { return *this; }
+    ~intrusive_ref_counter() = default;
+
+private:
+    mutable typename Policy::type count_{ 0 };
+
+    // intrusive_ptr 经由实参依赖查找调用这两个函数；
+    // 不继承本类的类型也可以自行提供同名函数接入 intrusive_ptr。
+    friend void intrusive_ptr_add_ref(const intrusive_ref_counter* p) noexcept {
+        Policy::increment(p->count_);
+    }
+
+    friend void intrusive_ptr_release(const intrusive_ref_counter* p) noexcept {
+        if (Policy::decrement(p->count_) == 0) {
+            delete static_cast<const T*>(p);
+        }
+    }
+};
+
+// 引用计数存放在对象内部的智能指针：没有控制块，句柄只有一个指针大小。
+// 计数的增减由 intrusive_ptr_add_ref/intrusive_ptr_release(T*) 完成。
+template <typename T>
+class intrusive_ptr {
+public:
+    using element_type = T;
+
+    constexpr intrusive_ptr() noexcept : ptr_(nullptr) {}
+    constexpr intrusive_ptr(std::nullptr_t) noexcept : intrusive_ptr() {}
+
+    // add_ref 为 false 时接管一个已计入本次引用的对象，与 detach 配对使用。
+    intrusive_ptr(T* ptr, bool add_ref = true) noexcept : ptr_(ptr) {
+        if (ptr_ != nullptr && add_ref) {
+            intrusive_ptr_add_ref(ptr_);
+        }
+    }
+
+    intrusive_ptr(const intrusive_ptr& other) noexcept : intrusive_ptr(other.ptr_) {}
+
+    template <typename U>
+        requires std::is_convertible_v<U*, T*>
+    intrusive_ptr(const intrusive_ptr<U>& other) noexcept : intrusive_ptr(other.get()) {}
+
+    intrusive_ptr(intrusive_ptr&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {}
+
+    template <typename U>
+        requires std::is_convertible_v<U*, T*>
+    intrusive_ptr(intrusive_ptr<U>&& other) noexcept : ptr_(other.detach()) {}
+
+#ifndef DISMISS_UNIQUE_PTR
+    // 从 unique_ptr 接过所有权。计数归零时对象以 delete 删除，因此只接受默认删除器。
+    template <typename U>
+        requires std::is_convertible_v<U*, T*>
+    intrusive_ptr(unique_ptr<U>&& other) noexcept : intrusive_ptr(other.release()) {}
+#endif
+
+    ~intrusive_ptr() {
+        if (ptr_ != nullptr) {
+            intrusive_ptr_release(ptr_);
+        }
+    }
+
+    intrusive_ptr& operator=(const intrusive_ptr& other) noexcept {
+        intrusive_ptr(other).swap(*this);
+        return *this;
+    }
+
+    template <typename U>
+    intrusive_ptr& operator=(const intrusive_ptr<U>& other) noexcept {
+        intrusive_ptr(other).swap(*this);
+        return *this;
+    }
+
+    intrusive_ptr& operator=(intrusive_ptr&& other) noexcept {
+        intrusive_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    template <typename U>
+    intrusive_ptr& operator=(intrusive_ptr<U>&& other) noexcept {
+        intrusive_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+#ifndef DISMISS_UNIQUE_PTR
+    template <typename U>
+    intrusive_ptr& operator=(unique_ptr<U>&& other) noexcept {
+        intrusive_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+#endif
+
+    void reset() noexcept {
+        intrusive_ptr().swap(*this);
+    }
+
+    void reset(T* ptr, bool add_ref = true) noexcept {
+        intrusive_ptr(ptr, add_ref).swap(*this);
+    }
+
+    // 放弃所有权但不减少计数，返回原先的指针。
+    T* detach() noexcept {
+        return std::exchange(ptr_, nullptr);
+    }
+
+    void swap(intrusive_ptr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+    }
+
+    T* get() const noexcept { return ptr_; }
+    T& operator*() const noexcept { return *ptr_; }
+    T* operator->() const noexcept { return ptr_; }
+    explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+private:
+    T* ptr_;
+};
+
+template <typename T, typename U>
+bool operator==(const intrusive_ptr<T>& a, const intrusive_ptr<U>& b) noexcept {
+    return a.get() == b.get();
+}
+
+template <typename T, typename U>
+std::strong_ordering operator<=>(const intrusive_ptr<T>& a, const intrusive_ptr<U>& b) noexcept {
+    return std::compare_three_way()(a.get(), b.get());
+}
+
+template <typename T>
+bool operator==(const intrusive_ptr<T>& p, std::nullptr_t) noexcept {
+    return !p;
+}
+
+template <typename T>
+void swap(intrusive_ptr<T>& a, intrusive_ptr<T>& b) noexcept {
+    a.swap(b);
+}
+
+template <typename T, typename... Args>
+intrusive_ptr<T> make_intrusive(Args&&... args) {
+    return intrusive_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+} // namespace my
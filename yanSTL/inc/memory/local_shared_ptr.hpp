@@ -0,0 +1,231 @@
+#pragma once
+#include "common.hpp"
+#include "../yan_allocator.hpp"
+#include <compare>
+#include <new>
+
+namespace my {
+
+// local_shared_ptr 的控制块：引用计数是普通整数，复制与析构不做原子操作。
+// 没有弱引用，计数归零时一并析构对象并释放控制块。
+class _local_control_block_base {
+public:
+    virtual ~_local_control_block_base() = default;
+    virtual void dispose_and_destroy() noexcept = 0;
+    size_t count = 1;
+
+    void add_shared() noexcept {
+        ++count;
+    }
+
+    void release_shared() noexcept {
+        if (--count == 0) {
+            dispose_and_destroy();
+        }
+    }
+};
+
+template <typename Y, typename Deleter>
+class _local_pointer_control_block : public _local_control_block_base {
+public:
+    _local_pointer_control_block(Y* ptr, Deleter deleter)
+        : ptr_(ptr), deleter_(std::move(deleter)) {}
+
+    void dispose_and_destroy() noexcept override {
+        deleter_(ptr_);
+        delete this;
+    }
+
+private:
+    Y* ptr_;
+    Deleter deleter_;
+};
+
+// 与 _inplace_control_block 相同，对象存放在控制块末尾，只需一次分配。
+template <typename T, typename Alloc>
+class _local_inplace_control_block : public _local_control_block_base {
+public:
+    using allocator_type = typename allocator_traits<Alloc>::template rebind_alloc<_local_inplace_control_block>;
+    using value_allocator = typename allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>;
+
+    template <typename... Args>
+    explicit _local_inplace_control_block(const Alloc& alloc, Args&&... args)
+        : alloc_(alloc) {
+        value_allocator a(alloc_);
+        allocator_traits<value_allocator>::construct(a, get(), std::forward<Args>(args)...);
+    }
+
+    std::remove_cv_t<T>* get() noexcept {
+        return std::launder(reinterpret_cast<std::remove_cv_t<T>*>(storage_));
+    }
+
+    void dispose_and_destroy() noexcept override {
+        value_allocator va(alloc_);
+        allocator_traits<value_allocator>::destroy(va, get());
+        allocator_type a(std::move(alloc_));
+        this->~_local_inplace_control_block();
+        allocator_traits<allocator_type>::deallocate(a, this, 1);
+    }
+
+private:
+    allocator_type alloc_;
+    alignas(T) unsigned char storage_[sizeof(T)];
+};
+
+// 只在单个线程内使用的 shared_ptr：引用计数不是原子的，
+// 同一对象的各个 local_shared_ptr 不能同时被不同线程复制或析构。
+template <typename T>
+class local_shared_ptr {
+public:
+    using element_type = std::remove_extent_t<T>;
+
+    constexpr local_shared_ptr() noexcept : ptr_(nullptr), cb_(nullptr) {}
+    constexpr local_shared_ptr(std::nullptr_t) noexcept : local_shared_ptr() {}
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    explicit local_shared_ptr(Y* ptr) : local_shared_ptr(ptr, std::default_delete<Y>()) {}
+
+    template <typename Y, typename Deleter>
+        requires (std::is_convertible_v<Y*, T*> && std::is_invocable_v<Deleter&, Y*>)
+    local_shared_ptr(Y* ptr, Deleter deleter) : ptr_(ptr), cb_(nullptr) {
+        try {
+            cb_ = new _local_pointer_control_block<Y, Deleter>(ptr, deleter);
+        }
+        catch (...) {
+            deleter(ptr);
+            throw;
+        }
+    }
+
+    // 别名构造：与 other 共享所有权，但 get() 返回 ptr。
+    template <typename Y>
+    local_shared_ptr(const local_shared_ptr<Y>& other, element_type* ptr) noexcept : ptr_(ptr), cb_(other.cb_) {
+        if (cb_ != nullptr) {
+            cb_->add_shared();
+        }
+    }
+
+    local_shared_ptr(const local_shared_ptr& other) noexcept : local_shared_ptr(other, other.ptr_) {}
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    local_shared_ptr(const local_shared_ptr<Y>& other) noexcept : local_shared_ptr(other, other.ptr_) {}
+
+    local_shared_ptr(local_shared_ptr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), cb_(std::exchange(other.cb_, nullptr)) {}
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    local_shared_ptr(local_shared_ptr<Y>&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), cb_(std::exchange(other.cb_, nullptr)) {}
+
+    ~local_shared_ptr() {
+        if (cb_ != nullptr) {
+            cb_->release_shared();
+        }
+    }
+
+    local_shared_ptr& operator=(const local_shared_ptr& other) noexcept {
+        local_shared_ptr(other).swap(*this);
+        return *this;
+    }
+
+    template <typename Y>
+    local_shared_ptr& operator=(const local_shared_ptr<Y>& other) noexcept {
+        local_shared_ptr(other).swap(*this);
+        return *this;
+    }
+
+    local_shared_ptr& operator=(local_shared_ptr&& other) noexcept {
+        local_shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    template <typename Y>
+    local_shared_ptr& operator=(local_shared_ptr<Y>&& other) noexcept {
+        local_shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void reset() noexcept {
+        local_shared_ptr().swap(*this);
+    }
+
+    template <typename Y>
+    void reset(Y* ptr) {
+        local_shared_ptr(ptr).swap(*this);
+    }
+
+    template <typename Y, typename Deleter>
+    void reset(Y* ptr, Deleter deleter) {
+        local_shared_ptr(ptr, std::move(deleter)).swap(*this);
+    }
+
+    void swap(local_shared_ptr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(cb_, other.cb_);
+    }
+
+    element_type* get() const noexcept { return ptr_; }
+    std::add_lvalue_reference_t<element_type> operator*() const noexcept { return *ptr_; }
+    element_type* operator->() const noexcept { return ptr_; }
+    long use_count() const noexcept { return cb_ != nullptr ? static_cast<long>(cb_->count) : 0; }
+    explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+private:
+    template <typename U>
+    friend class local_shared_ptr;
+    template <typename U, typename Alloc, typename... Args>
+    friend local_shared_ptr<U> allocate_local_shared(const Alloc& alloc, Args&&... args);
+
+    // 接管一个已计入本次引用的控制块。
+    local_shared_ptr(element_type* ptr, _local_control_block_base* cb) noexcept : ptr_(ptr), cb_(cb) {}
+
+    element_type* ptr_;
+    _local_control_block_base* cb_;
+};
+
+template <typename T, typename U>
+bool operator==(const local_shared_ptr<T>& a, const local_shared_ptr<U>& b) noexcept {
+    return a.get() == b.get();
+}
+
+template <typename T, typename U>
+std::strong_ordering operator<=>(const local_shared_ptr<T>& a, const local_shared_ptr<U>& b) noexcept {
+    return std::compare_three_way()(a.get(), b.get());
+}
+
+template <typename T>
+bool operator==(const local_shared_ptr<T>& p, std::nullptr_t) noexcept {
+    return !p;
+}
+
+template <typename T>
+void swap(local_shared_ptr<T>& a, local_shared_ptr<T>& b) noexcept {
+    a.swap(b);
+}
+
+template <typename T, typename Alloc, typename... Args>
+local_shared_ptr<T> allocate_local_shared(const Alloc& alloc, Args&&... args) {
+    using block = _local_inplace_control_block<T, Alloc>;
+    using traits = allocator_traits<typename block::allocator_type>;
+    typename block::allocator_type a(alloc);
+    auto storage = traits::allocate(a, 1);
+    block* cb;
+    try {
+        cb = ::new (static_cast<void*>(std::to_address(storage))) block(alloc, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        traits::deallocate(a, storage, 1);
+        throw;
+    }
+    return local_shared_ptr<T>(cb->get(), cb);
+}
+
+template <typename T, typename... Args>
+local_shared_ptr<T> make_local_shared(Args&&... args) {
+    return my::allocate_local_shared<T>(allocator<std::remove_cv_t<T>>(), std::forward<Args>(args)...);
+}
+
+} // namespace my
@@ -1,23 +1,705 @@
+#pragma once
+#include "common.hpp"
+#include "../yan_allocator.hpp"
 #include <atomic>
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
 #include <stdexcept>
 
 namespace my {
 
+class control_block_base;
+
+// 偏向引用计数中每个线程一个的合并队列。
+// 非所有者线程释放强引用、使共享部分首次变为负数时，说明所有者的偏向计数中有引用已转交出去，
+// 此时把控制块交给所有者线程合并；所有者在创建控制块、释放偏向引用、离开 biased_shared_scope 与退出时处理队列。
+// 线程退出后队列标记为已关闭，此后的入队者由自己代为合并。
+// 与统计分片一样从不释放，不再被未合并的控制块引用后留待新线程复用。
+struct _brc_queue {
+    std::atomic<control_block_base*> head{ nullptr };
+    std::atomic<size_t> owned{ 0 }; // 以本队列为所有者、尚未合并的控制块数
+    _brc_queue* next = nullptr;
+    bool in_use = false;
+
+    static control_block_base* closed() noexcept {
+        return reinterpret_cast<control_block_base*>(alignof(std::max_align_t));
+    }
+
+    // 调用线程的队列；线程已退出（在其余 thread_local 对象析构时）返回空。
+    static _brc_queue* current();
+
+    // 入队失败说明所有者已退出。
+    bool push(control_block_base* cb) noexcept;
+
+    // 合并队列中所有的控制块，之后把队列头置为 last。只由所有者调用。
+    void drain(control_block_base* last = nullptr) noexcept;
+
+    // 队列非空时处理之。线程退出时关闭队列的过程中不再处理。
+    void drain_pending() noexcept {
+        if (control_block_base* top = head.load(std::memory_order_relaxed); top != nullptr && top != closed()) [[unlikely]] {
+            drain();
+        }
+    }
+};
+
+class _brc_registry {
+public:
+    static _brc_registry& get_instance() {
+        // 与中心池一样永不析构。
+        alignas(_brc_registry) static std::byte storage[sizeof(_brc_registry)];
+        static _brc_registry* instance = ::new (storage) _brc_registry;
+        return *instance;
+    }
+
+    _brc_queue* acquire() {
+        std::lock_guard lock(mutex_);
+        for (_brc_queue* q = queues_; q != nullptr; q = q->next) {
+            if (!q->in_use && q->owned.load(std::memory_order_acquire) == 0) {
+                q->in_use = true;
+                q->head.store(nullptr, std::memory_order_relaxed);
+                return q;
+            }
+        }
+        auto* q = _system_heap::create<_brc_queue>();
+        q->in_use = true;
+        q->next = queues_;
+        queues_ = q;
+        return q;
+    }
+
+    // 线程退出时关闭并交还队列。
+    void release(_brc_queue* q) noexcept {
+        q->drain(_brc_queue::closed());
+        std::lock_guard lock(mutex_);
+        q->in_use = false;
+    }
+
+private:
+    std::mutex mutex_;
+    _brc_queue* queues_ = nullptr;
+};
+
+inline constinit thread_local _brc_queue* _tls_brc_queue = nullptr;
+inline constinit thread_local bool _tls_brc_retired = false;
+inline constinit thread_local unsigned _tls_brc_depth = 0; // 嵌套的 biased_shared_scope 层数
+
+struct _brc_queue_reaper {
+    ~_brc_queue_reaper() {
+        _brc_registry::get_instance().release(_tls_brc_queue);
+        _tls_brc_queue = nullptr;
+        _tls_brc_retired = true;
+    }
+};
+
+// 控制块的类型相关操作。每种控制块有一张静态的函数表，控制块只保存指向它的指针，
+// 不需要虚函数表和虚析构函数。
+struct _control_block_ops {
+    void (*dispose)(control_block_base*) noexcept; // 析构被管理的对象
+    void (*destroy)(control_block_base*) noexcept; // 释放控制块自身
+    // 最后一个强引用释放且没有弱引用时，合为一次调用。
+    void (*dispose_and_destroy)(control_block_base*) noexcept;
+};
+
+// 为控制块类型 Block 生成函数表，Block 需提供非虚的 dispose 与 destroy。
+template <typename Block>
+struct _control_block_ops_for {
+    static void dispose(control_block_base* cb) noexcept {
+        static_cast<Block*>(cb)->dispose();
+    }
+
+    static void destroy(control_block_base* cb) noexcept {
+        static_cast<Block*>(cb)->destroy();
+    }
+
+    static void dispose_and_destroy(control_block_base* cb) noexcept {
+        static_cast<Block*>(cb)->dispose();
+        static_cast<Block*>(cb)->destroy();
+    }
+
+    static constexpr _control_block_ops value{ &dispose, &destroy, &dispose_and_destroy };
+};
+
+// 在 biased_shared_scope 内创建的控制块采用偏向引用计数，其余的控制块创建时即处于已合并的状态，
+// 只使用共享部分，与普通的原子计数相同。
+// 偏向引用计数：创建控制块的线程（所有者）增减 biased_count 时只做普通的读写，
+// 其他线程原子地增减共享部分。共享部分低两位为标志：
+// 第 0 位表示已合并，即 biased_count 已并入且所有者不再使用它；第 1 位表示已交给所有者合并。
+// 所有者的偏向计数归零时合并；合并后共享部分的计数归零即释放对象。
+// 在合并之前，所有者手中至少还有一个引用，对象必然存活，共享部分的计数可以为负。
+// 共享部分与弱引用数放在同一个 64 位的 counts 中：低 32 位为共享部分加上 2^31 的偏移，
+// 计数为负时也不会向高位借位；高 32 位为弱引用数。各自的计数上限因此约为 2^29 与 2^32。
 class control_block_base {
 public:
-    virtual ~control_block_base() = default;
-    virtual void dispose() noexcept = 0;
-    virtual void destroy() noexcept = 0;
-    std::atomic<size_t> shared_count{ 1 };
-    std::atomic<size_t> weak_count{ 0 };
+    static constexpr intptr_t merged_flag = 1;
+    static constexpr intptr_t queued_flag = 2;
+    static constexpr intptr_t one = 4;
+    static constexpr std::uint64_t weak_one = std::uint64_t(1) << 32;
+
+    explicit control_block_base(const _control_block_ops* ops) : ops(ops) {
+        if (_tls_brc_depth != 0) {
+            if (_brc_queue* q = _brc_queue::current()) {
+                owner.store(q, std::memory_order_relaxed);
+                biased_count.store(1, std::memory_order_relaxed);
+                q->owned.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        counts.store(_pack(one | merged_flag, 1), std::memory_order_relaxed);
+    }
+
+    control_block_base(const control_block_base&) = delete;
+    control_block_base& operator=(const control_block_base&) = delete;
+
+    const _control_block_ops* ops;
+    // 所有强引用合计持有一个弱引用，最后一个强引用释放时交还，
+    // 因此弱引用数归零时控制块一定已不再被任何人使用。
+    std::atomic<std::uint64_t> counts{ _pack(0, 1) };
+    std::atomic<size_t> biased_count{ 0 };
+    std::atomic<_brc_queue*> owner{ nullptr }; // 合并后为空
+    control_block_base* next_queued = nullptr;
+
+    static constexpr std::uint64_t _pack(intptr_t shared, std::uint64_t weak) noexcept {
+        return (static_cast<std::uint32_t>(shared) ^ 0x8000'0000u) | weak << 32;
+    }
+
+    static constexpr intptr_t _shared_of(std::uint64_t counts) noexcept {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(counts) ^ 0x8000'0000u);
+    }
+
+    static constexpr std::uint64_t _weak_of(std::uint64_t counts) noexcept {
+        return counts >> 32;
+    }
+
+    // 调用线程是否为尚未合并的所有者。偏向计数只由所有者读写，用 relaxed 的原子变量
+    // 只是为了让 use_count 可以在其他线程读取，编译后与普通的读写相同。
+    // 先读 owner，未采用偏向计数的控制块不必读线程局部变量。
+    bool is_owner() const noexcept {
+        _brc_queue* q = owner.load(std::memory_order_relaxed);
+        return q != nullptr && q == _tls_brc_queue;
+    }
+
+    void add_shared() noexcept {
+        if (is_owner()) {
+            biased_count.store(biased_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else {
+            counts.fetch_add(one, std::memory_order_relaxed);
+        }
+    }
+
+    // 强引用数不为零时加一，供 weak_ptr::lock 使用。非所有者只需对 counts 做一次 CAS。
+    bool try_add_shared() noexcept {
+        if (is_owner()) {
+            biased_count.store(biased_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+        std::uint64_t current = counts.load(std::memory_order_relaxed);
+        for (;;) {
+            const intptr_t shared = _shared_of(current);
+            if ((shared & merged_flag) && shared < one) {
+                return false;
+            }
+            if (counts.compare_exchange_weak(current, current + one, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    void release_shared() noexcept {
+        if (is_owner()) {
+            const size_t count = biased_count.load(std::memory_order_relaxed) - 1;
+            biased_count.store(count, std::memory_order_relaxed);
+            if (count == 0) {
+                merge();
+            }
+            // 使转交给其他线程的对象尽早释放。
+            _tls_brc_queue->drain_pending();
+            return;
+        }
+        const std::uint64_t current = counts.fetch_sub(one, std::memory_order_acq_rel) - one;
+        const intptr_t shared = _shared_of(current);
+        if (shared < one && (shared & merged_flag)) {
+            release_last(current);
+        }
+        else if (shared < 0 && !(shared & (merged_flag | queued_flag))) {
+            request_merge();
+        }
+    }
+
+    void add_weak() noexcept {
+        counts.fetch_add(weak_one, std::memory_order_relaxed);
+    }
+
+    void release_weak() noexcept {
+        if (_weak_of(counts.fetch_sub(weak_one, std::memory_order_acq_rel)) == 1) {
+            ops->destroy(this);
+        }
+    }
+
+    // 与 try_add_shared 的判断一致：合并之前所有者手中至少还有一个引用，对象必然存活，
+    // 即使转交出去的引用都已释放、共享部分为负，也至少算作 1。
+    size_t use_count() const noexcept {
+        const intptr_t shared = _shared_of(counts.load(std::memory_order_relaxed));
+        if (shared & merged_flag) {
+            return shared >= one ? static_cast<size_t>(shared >> 2) : 0;
+        }
+        const intptr_t count = static_cast<intptr_t>(biased_count.load(std::memory_order_relaxed)) + (shared >> 2);
+        return count > 0 ? static_cast<size_t>(count) : 1;
+    }
+
+    // 把偏向计数并入共享部分。只由所有者，或在所有者退出后由唯一的入队者调用。
+    void merge() noexcept {
+        _brc_queue* q = owner.load(std::memory_order_relaxed);
+        const intptr_t biased = static_cast<intptr_t>(biased_count.load(std::memory_order_relaxed));
+        biased_count.store(0, std::memory_order_relaxed);
+        owner.store(nullptr, std::memory_order_relaxed);
+        const std::uint64_t delta = static_cast<std::uint64_t>(biased * one + merged_flag);
+        const std::uint64_t current = counts.fetch_add(delta, std::memory_order_acq_rel) + delta;
+        q->owned.fetch_sub(1, std::memory_order_release);
+        if (_shared_of(current) < one) {
+            release_last(current);
+        }
+    }
+
+protected:
+    ~control_block_base() {
+        // 对象构造失败时控制块未经合并即被销毁。
+        if (_brc_queue* q = owner.load(std::memory_order_relaxed)) {
+            q->owned.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+private:
+    // 共享部分首次变为负数时，把控制块交给所有者合并；所有者已退出时自己合并。
+    void request_merge() noexcept {
+        const intptr_t shared = _shared_of(counts.fetch_or(queued_flag, std::memory_order_acq_rel));
+        _brc_queue* q = owner.load(std::memory_order_relaxed);
+        // 已有人入队，或者所有者刚刚合并。
+        if ((shared & (merged_flag | queued_flag)) || q == nullptr) {
+            return;
+        }
+        // 队列持有一个弱引用，保证合并前控制块不被释放。
+        add_weak();
+        if (!q->push(this)) {
+            // 队列关闭后所有者不再访问偏向计数；尚未合并的控制块使队列不会被复用。
+            if (owner.load(std::memory_order_relaxed) == q) {
+                merge();
+            }
+            release_weak();
+        }
+    }
+
+    // current 是刚把强引用数减为零的那次读-改-写的结果。弱引用数为 1 时只剩强引用合计持有的那一个，
+    // 此时已没有任何人能再访问控制块，不必再对 counts 做一次原子操作。
+    void release_last(std::uint64_t current) noexcept {
+        if (_weak_of(current) == 1) {
+            ops->dispose_and_destroy(this);
+            return;
+        }
+        ops->dispose(this);
+        release_weak();
+    }
+};
+
+inline _brc_queue* _brc_queue::current() {
+    _brc_queue* q = _tls_brc_queue;
+    if (q == nullptr) {
+        if (_tls_brc_retired) {
+            return nullptr;
+        }
+        thread_local _brc_queue_reaper reaper;
+        (void)reaper;
+        q = _tls_brc_queue = _brc_registry::get_instance().acquire();
+    }
+    q->drain_pending();
+    return q;
+}
+
+inline bool _brc_queue::push(control_block_base* cb) noexcept {
+    control_block_base* top = head.load(std::memory_order_acquire);
+    do {
+        if (top == closed()) {
+            return false;
+        }
+        cb->next_queued = top;
+    } while (!head.compare_exchange_weak(top, cb, std::memory_order_release, std::memory_order_acquire));
+    return true;
+}
+
+inline void _brc_queue::drain(control_block_base* last) noexcept {
+    control_block_base* cb = head.exchange(last, std::memory_order_acquire);
+    while (cb != nullptr) {
+        control_block_base* next = cb->next_queued;
+        // 偏向计数可能已归零并合并。
+        if (cb->owner.load(std::memory_order_relaxed) == this) {
+            cb->merge();
+        }
+        cb->release_weak();
+        cb = next;
+    }
+}
+
+// 在作用域内，调用线程创建的控制块采用偏向引用计数：本线程复制与销毁这些 shared_ptr 时不做原子操作。
+// 代价是析构可能推迟：本线程先释放了自己的引用、最后一个引用又在其他线程释放时，
+// 对象要等本线程下一次创建或释放 shared_ptr、调用 drain、离开最外层作用域或退出时才析构。
+// 只应在频繁复制 shared_ptr 且会持续使用它们的线程上开启。作用域可以嵌套。
+class biased_shared_scope {
+public:
+    biased_shared_scope() noexcept {
+        ++_tls_brc_depth;
+    }
+
+    biased_shared_scope(const biased_shared_scope&) = delete;
+    biased_shared_scope& operator=(const biased_shared_scope&) = delete;
+
+    ~biased_shared_scope() {
+        if (--_tls_brc_depth == 0) {
+            drain();
+        }
+    }
+
+    // 合并其他线程交给本线程的控制块，析构其中已无引用的对象。
+    static void drain() noexcept {
+        if (_brc_queue* q = _tls_brc_queue) {
+            q->drain_pending();
+        }
+    }
 };
 
-/// 在此处继承control_block_base并实现控制块逻辑。
+// 由 shared_ptr(ptr, deleter) 创建，控制块与对象分开分配。
+template <typename Y, typename Deleter>
+class _pointer_control_block : public control_block_base {
+public:
+    _pointer_control_block(Y* ptr, Deleter deleter)
+        : control_block_base(&_control_block_ops_for<_pointer_control_block>::value),
+          ptr_(ptr), deleter_(std::move(deleter)) {}
+
+    void dispose() noexcept {
+        deleter_(ptr_);
+    }
+
+    void destroy() noexcept {
+        delete this;
+    }
+
+private:
+    Y* ptr_;
+    Deleter deleter_;
+};
+
+struct _for_overwrite_t {
+    explicit _for_overwrite_t() = default;
+};
+
+// 由 make_shared/allocate_shared 创建：对象就存放在控制块的末尾，
+// 二者只需一次分配，引用计数与对象开头的数据通常位于同一缓存行。
+// 控制块与对象分别经由重新绑定到各自类型的分配器分配和构造。
+template <typename T, typename Alloc>
+class _inplace_control_block : public control_block_base {
+public:
+    using allocator_type = typename allocator_traits<Alloc>::template rebind_alloc<_inplace_control_block>;
+    using value_allocator = typename allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>;
+
+    template <typename... Args>
+    explicit _inplace_control_block(const Alloc& alloc, Args&&... args)
+        : control_block_base(&_control_block_ops_for<_inplace_control_block>::value), alloc_(alloc) {
+        value_allocator a(alloc_);
+        allocator_traits<value_allocator>::construct(a, get(), std::forward<Args>(args)...);
+    }
+
+    // 默认初始化对象，供 make_shared_for_overwrite 使用。
+    _inplace_control_block(_for_overwrite_t, const Alloc& alloc)
+        : control_block_base(&_control_block_ops_for<_inplace_control_block>::value), alloc_(alloc) {
+        ::new (static_cast<void*>(get())) std::remove_cv_t<T>;
+    }
+
+    std::remove_cv_t<T>* get() noexcept {
+        return std::launder(reinterpret_cast<std::remove_cv_t<T>*>(storage_));
+    }
+
+    void dispose() noexcept {
+        value_allocator a(alloc_);
+        allocator_traits<value_allocator>::destroy(a, get());
+    }
+
+    void destroy() noexcept {
+        allocator_type a(std::move(alloc_));
+        this->~_inplace_control_block();
+        allocator_traits<allocator_type>::deallocate(a, this, 1);
+    }
+
+private:
+    allocator_type alloc_;
+    alignas(T) unsigned char storage_[sizeof(T)];
+};
+
+// 由数组形式的 make_shared/allocate_shared 创建：元素紧跟在控制块之后，与控制块同属一次分配。
+// E 为最内层的元素类型，多维数组被展开为 count_ 个 E 逐个构造，析构时逆序进行。
+// 内存以对齐到控制块与 E 中较严格者的单元为单位分配，元素的起点因此对齐。
+template <typename E, typename Alloc>
+class _inplace_array_control_block : public control_block_base {
+public:
+    using value_allocator = typename allocator_traits<Alloc>::template rebind_alloc<E>;
+
+    // 分配内存并构造控制块，init(a, p, i) 在 p 处构造第 i 个元素。
+    template <typename Init>
+    static _inplace_array_control_block* create(const Alloc& alloc, size_t count, Init init) {
+        using traits = allocator_traits<_unit_allocator>;
+        _unit_allocator a(alloc);
+        const size_t units = _units(count);
+        auto storage = traits::allocate(a, units);
+        try {
+            return ::new (static_cast<void*>(std::to_address(storage))) _inplace_array_control_block(alloc, count, init);
+        }
+        catch (...) {
+            traits::deallocate(a, storage, units);
+            throw;
+        }
+    }
+
+    E* data() noexcept {
+        return std::launder(reinterpret_cast<E*>(reinterpret_cast<unsigned char*>(this) + _offset()));
+    }
+
+    void dispose() noexcept {
+        _destroy_elements(count_);
+    }
+
+    void destroy() noexcept {
+        _unit_allocator a(std::move(alloc_));
+        const size_t units = _units(count_);
+        this->~_inplace_array_control_block();
+        allocator_traits<_unit_allocator>::deallocate(a, reinterpret_cast<_unit*>(this), units);
+    }
+
+private:
+    struct _unit;
+    using _unit_allocator = typename allocator_traits<Alloc>::template rebind_alloc<_unit>;
+
+    template <typename Init>
+    _inplace_array_control_block(const Alloc& alloc, size_t count, Init& init)
+        : control_block_base(&_control_block_ops_for<_inplace_array_control_block>::value), alloc_(alloc), count_(count) {
+        E* p = data();
+        size_t i = 0;
+        try {
+            for (; i < count; ++i) {
+                init(alloc_, p + i, i);
+            }
+        }
+        catch (...) {
+            _destroy_elements(i);
+            throw;
+        }
+    }
+
+    static constexpr size_t _offset() noexcept {
+        return (sizeof(_inplace_array_control_block) + alignof(E) - 1) / alignof(E) * alignof(E);
+    }
+
+    static size_t _units(size_t count) {
+        if (count > (SIZE_MAX - _offset()) / sizeof(E)) {
+            throw std::bad_array_new_length();
+        }
+        return (_offset() + count * sizeof(E) + sizeof(_unit) - 1) / sizeof(_unit);
+    }
+
+    void _destroy_elements(size_t count) noexcept {
+        E* p = data();
+        while (count != 0) {
+            allocator_traits<value_allocator>::destroy(alloc_, p + --count);
+        }
+    }
+
+    value_allocator alloc_;
+    size_t count_;
+};
+
+template <typename E, typename Alloc>
+struct _inplace_array_control_block<E, Alloc>::_unit {
+    alignas(_inplace_array_control_block) alignas(E) unsigned char bytes[
+        alignof(_inplace_array_control_block) > alignof(E) ? alignof(_inplace_array_control_block) : alignof(E)];
+};
+
+#ifndef DISMISS_ENABLE_SHARED_FROM_THIS
+// 若 Y 公开且无歧义地继承自某个 enable_shared_from_this<U>，返回指向该基类的指针。
+template <typename U>
+const enable_shared_from_this<U>* _shared_from_this_base(const enable_shared_from_this<U>* ptr) noexcept {
+    return ptr;
+}
+#endif
+
+struct _shared_ptr_access;
+
+// 以 Y* 构造 shared_ptr<T> 的条件，与 std::shared_ptr 相同：
+// T 为 U[N] 或 U[] 时要求 Y(*)[N] 或 Y(*)[] 可转换为 T*，否则要求 Y* 可转换为 T*。
+template <typename Y, typename T>
+struct _shared_ptr_convertible : std::is_convertible<Y*, T*> {};
+
+template <typename Y, typename U, size_t N>
+struct _shared_ptr_convertible<Y, U[N]> : std::is_convertible<Y(*)[N], U(*)[N]> {};
+
+template <typename Y, typename U>
+struct _shared_ptr_convertible<Y, U[]> : std::is_convertible<Y(*)[], U(*)[]> {};
 
 template <typename T>
 class shared_ptr {
+public:
+    using element_type = std::remove_extent_t<T>;
+    using weak_type = weak_ptr<T>;
+
+    constexpr shared_ptr() noexcept : ptr_(nullptr), cb_(nullptr) {}
+    constexpr shared_ptr(std::nullptr_t) noexcept : shared_ptr() {}
+
+    // T 为数组时以 delete[] 删除。
+    template <typename Y>
+        requires _shared_ptr_convertible<Y, T>::value
+    explicit shared_ptr(Y* ptr)
+        : shared_ptr(ptr, std::conditional_t<std::is_array_v<T>, std::default_delete<Y[]>, std::default_delete<Y>>()) {}
 
-    /// 在此处实现 shared_ptr 相关成员。
+    // 创建控制块失败时以 deleter 删除 ptr 后再抛出异常。
+    template <typename Y, typename Deleter>
+        requires (_shared_ptr_convertible<Y, T>::value && std::is_invocable_v<Deleter&, Y*>)
+    shared_ptr(Y* ptr, Deleter deleter) : ptr_(ptr), cb_(nullptr) {
+        try {
+            cb_ = new _pointer_control_block<Y, Deleter>(ptr, deleter);
+        }
+        catch (...) {
+            deleter(ptr);
+            throw;
+        }
+        _enable_shared_from_this(ptr);
+    }
+
+    // 持有空指针，但 use_count 为 1，最后一个引用消失时调用 deleter(nullptr)。
+    template <typename Deleter>
+        requires std::is_invocable_v<Deleter&, element_type*>
+    shared_ptr(std::nullptr_t, Deleter deleter) : shared_ptr(static_cast<element_type*>(nullptr), std::move(deleter)) {}
+
+#ifndef DISMISS_UNIQUE_PTR
+    // 接管 other 的对象与删除器；删除器为引用时保存 std::reference_wrapper。
+    // other 为空时得到空的 shared_ptr；创建控制块失败时 other 不变。
+    template <typename Y, typename D>
+        requires (std::is_array_v<Y> == std::is_array_v<T> && _shared_ptr_convertible<std::remove_extent_t<Y>, T>::value)
+    shared_ptr(unique_ptr<Y, D>&& other) : ptr_(other.get()), cb_(nullptr) {
+        using stored_deleter = std::conditional_t<std::is_reference_v<D>, std::reference_wrapper<std::remove_reference_t<D>>, D>;
+        if (other.get() != nullptr) {
+            cb_ = new _pointer_control_block<std::remove_extent_t<Y>, stored_deleter>(other.get(), std::forward<D>(other.get_deleter()));
+            _enable_shared_from_this(other.release());
+        }
+    }
+#endif
+
+    // 别名构造：与 other 共享所有权，但 get() 返回 ptr。
+    template <typename Y>
+    shared_ptr(const shared_ptr<Y>& other, element_type* ptr) noexcept : ptr_(ptr), cb_(other.cb_) {
+        if (cb_ != nullptr) {
+            cb_->add_shared();
+        }
+    }
+
+    template <typename Y>
+    shared_ptr(shared_ptr<Y>&& other, element_type* ptr) noexcept : ptr_(ptr), cb_(std::exchange(other.cb_, nullptr)) {
+        other.ptr_ = nullptr;
+    }
+
+    shared_ptr(const shared_ptr& other) noexcept : shared_ptr(other, other.ptr_) {}
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    shared_ptr(const shared_ptr<Y>& other) noexcept : shared_ptr(other, other.ptr_) {}
+
+    shared_ptr(shared_ptr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), cb_(std::exchange(other.cb_, nullptr)) {}
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    shared_ptr(shared_ptr<Y>&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), cb_(std::exchange(other.cb_, nullptr)) {}
+
+    // other 已失效时抛出 std::bad_weak_ptr。
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    explicit shared_ptr(const weak_ptr<Y>& other) : ptr_(other.ptr_), cb_(other.cb_) {
+        if (cb_ == nullptr || !cb_->try_add_shared()) {
+            throw std::bad_weak_ptr();
+        }
+    }
+
+    ~shared_ptr() {
+        if (cb_ != nullptr) {
+            cb_->release_shared();
+        }
+    }
+
+    shared_ptr& operator=(const shared_ptr& other) noexcept {
+        // 已共享同一控制块时不必增减引用计数。
+        if (cb_ == other.cb_) {
+            ptr_ = other.ptr_;
+            return *this;
+        }
+        shared_ptr(other).swap(*this);
+        return *this;
+    }
+
+    template <typename Y>
+    shared_ptr& operator=(const shared_ptr<Y>& other) noexcept {
+        shared_ptr(other).swap(*this);
+        return *this;
+    }
+
+    shared_ptr& operator=(shared_ptr&& other) noexcept {
+        shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    template <typename Y>
+    shared_ptr& operator=(shared_ptr<Y>&& other) noexcept {
+        shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+#ifndef DISMISS_UNIQUE_PTR
+    template <typename Y, typename D>
+    shared_ptr& operator=(unique_ptr<Y, D>&& other) {
+        shared_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+#endif
+
+    void reset() noexcept {
+        shared_ptr().swap(*this);
+    }
+
+    template <typename Y>
+    void reset(Y* ptr) {
+        shared_ptr(ptr).swap(*this);
+    }
+
+    template <typename Y, typename Deleter>
+    void reset(Y* ptr, Deleter deleter) {
+        shared_ptr(ptr, std::move(deleter)).swap(*this);
+    }
+
+    void swap(shared_ptr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(cb_, other.cb_);
+    }
+
+    element_type* get() const noexcept { return ptr_; }
+    std::add_lvalue_reference_t<element_type> operator*() const noexcept { return *ptr_; }
+    element_type* operator->() const noexcept { return ptr_; }
+    element_type& operator[](std::ptrdiff_t i) const noexcept requires std::is_array_v<T> { return ptr_[i]; }
+    long use_count() const noexcept { return cb_ != nullptr ? static_cast<long>(cb_->use_count()) : 0; }
+    explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+    // 按控制块的地址排序，共享所有权的指针彼此等价。
+    template <typename Y>
+    bool owner_before(const shared_ptr<Y>& other) const noexcept { return std::less<>()(cb_, other.cb_); }
+    template <typename Y>
+    bool owner_before(const weak_ptr<Y>& other) const noexcept { return std::less<>()(cb_, other.cb_); }
 
 private:
     template <typename U>
@@ -26,31 +708,385 @@ private:
     friend class weak_ptr;
     template <typename U>
     friend class enable_shared_from_this;
+    template <typename U>
+    friend class _atomic_smart_ptr;
+    friend struct _shared_ptr_access;
+
+    // 接管一个已计入本次引用的控制块。
+    shared_ptr(element_type* ptr, control_block_base* cb) noexcept : ptr_(ptr), cb_(cb) {}
 
-    T* ptr_;
+    template <typename Y>
+    void _enable_shared_from_this(Y* ptr) noexcept {
+#ifndef DISMISS_ENABLE_SHARED_FROM_THIS
+        if constexpr (!std::is_array_v<T> && requires { my::_shared_from_this_base(ptr); }) {
+            if (ptr != nullptr) {
+                my::_shared_from_this_base(ptr)->_weak_assign(ptr, cb_);
+            }
+        }
+#endif
+    }
+
+    element_type* ptr_;
     control_block_base* cb_;
 };
 
 template <typename T>
 class weak_ptr {
- 
-    /// 在此处实现 weak_ptr 相关成员。
+public:
+    using element_type = std::remove_extent_t<T>;
+
+    constexpr weak_ptr() noexcept : ptr_(nullptr), cb_(nullptr) {}
+
+    weak_ptr(const weak_ptr& other) noexcept : ptr_(other.ptr_), cb_(other.cb_) {
+        if (cb_ != nullptr) {
+            cb_->add_weak();
+        }
+    }
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    weak_ptr(const weak_ptr<Y>& other) noexcept : weak_ptr(other.lock()) {}
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, T*>
+    weak_ptr(const shared_ptr<Y>& other) noexcept : ptr_(other.ptr_), cb_(other.cb_) {
+        if (cb_ != nullptr) {
+            cb_->add_weak();
+        }
+    }
+
+    weak_ptr(weak_ptr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), cb_(std::exchange(other.cb_, nullptr)) {}
+
+    ~weak_ptr() {
+        if (cb_ != nullptr) {
+            cb_->release_weak();
+        }
+    }
+
+    weak_ptr& operator=(const weak_ptr& other) noexcept {
+        weak_ptr(other).swap(*this);
+        return *this;
+    }
+
+    template <typename Y>
+    weak_ptr& operator=(const weak_ptr<Y>& other) noexcept {
+        weak_ptr(other).swap(*this);
+        return *this;
+    }
+
+    template <typename Y>
+    weak_ptr& operator=(const shared_ptr<Y>& other) noexcept {
+        weak_ptr(other).swap(*this);
+        return *this;
+    }
+
+    weak_ptr& operator=(weak_ptr&& other) noexcept {
+        weak_ptr(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void reset() noexcept {
+        weak_ptr().swap(*this);
+    }
+
+    void swap(weak_ptr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(cb_, other.cb_);
+    }
+
+    long use_count() const noexcept { return cb_ != nullptr ? static_cast<long>(cb_->use_count()) : 0; }
+    bool expired() const noexcept { return use_count() == 0; }
+
+    // 对象仍存活时返回共享其所有权的 shared_ptr，否则返回空。
+    shared_ptr<T> lock() const noexcept {
+        if (cb_ != nullptr && cb_->try_add_shared()) {
+            return shared_ptr<T>(ptr_, cb_);
+        }
+        return shared_ptr<T>();
+    }
+
+    template <typename Y>
+    bool owner_before(const shared_ptr<Y>& other) const noexcept { return std::less<>()(cb_, other.cb_); }
+    template <typename Y>
+    bool owner_before(const weak_ptr<Y>& other) const noexcept { return std::less<>()(cb_, other.cb_); }
 
 private:
     template <typename U>
     friend class shared_ptr;
+    template <typename U>
+    friend class weak_ptr;
+    template <typename U>
+    friend class enable_shared_from_this;
+    template <typename U>
+    friend class _atomic_smart_ptr;
 
-    T* ptr_;
+    element_type* ptr_;
     control_block_base* cb_;
 };
 
-#ifndef DISMISS_ENABLE_SHARED_FROM_THIS 
+#ifndef DISMISS_ENABLE_SHARED_FROM_THIS
+
+template <typename T>
+class enable_shared_from_this {
+public:
+    // 对象不由 shared_ptr 管理时抛出 std::bad_weak_ptr。
+    shared_ptr<T> shared_from_this() { return shared_ptr<T>(weak_this_); }
+    shared_ptr<const T> shared_from_this() const { return shared_ptr<const T>(weak_this_); }
+    weak_ptr<T> weak_from_this() noexcept { return weak_this_; }
+    weak_ptr<const T> weak_from_this() const noexcept { return weak_this_; }
 
-/// 在此处实现 enable_shared_from_this 相关逻辑。
+protected:
+    constexpr enable_shared_from_this() noexcept = default;
+    // 复制对象不复制所有权信息。
+    enable_shared_from_this(const enable_shared_from_this&) noexcept {}
+    enable_shared_from_this& operator=(const enable_shared_from_this&) noexcept { return *this; }
+    ~enable_shared_from_this() = default;
+
+private:
+    template <typename U>
+    friend class shared_ptr;
+
+    // 由第一个接管对象的 shared_ptr 调用。
+    void _weak_assign(const T* ptr, control_block_base* cb) const noexcept {
+        if (weak_this_.expired()) {
+            weak_ptr<T> weak;
+            weak.ptr_ = const_cast<T*>(ptr);
+            weak.cb_ = cb;
+            cb->add_weak();
+            weak_this_ = std::move(weak);
+        }
+    }
+
+    mutable weak_ptr<T> weak_this_;
+};
 
 #endif
 
+template <typename T, typename U>
+bool operator==(const shared_ptr<T>& a, const shared_ptr<U>& b) noexcept {
+    return a.get() == b.get();
+}
+
+template <typename T, typename U>
+std::strong_ordering operator<=>(const shared_ptr<T>& a, const shared_ptr<U>& b) noexcept {
+    return std::compare_three_way()(a.get(), b.get());
+}
+
+template <typename T>
+bool operator==(const shared_ptr<T>& p, std::nullptr_t) noexcept {
+    return !p;
+}
+
+template <typename T>
+void swap(shared_ptr<T>& a, shared_ptr<T>& b) noexcept {
+    a.swap(b);
+}
+
+template <typename T>
+void swap(weak_ptr<T>& a, weak_ptr<T>& b) noexcept {
+    a.swap(b);
+}
+
+template <typename T, typename U>
+shared_ptr<T> static_pointer_cast(const shared_ptr<U>& p) noexcept {
+    return shared_ptr<T>(p, static_cast<typename shared_ptr<T>::element_type*>(p.get()));
+}
+
+template <typename T, typename U>
+shared_ptr<T> const_pointer_cast(const shared_ptr<U>& p) noexcept {
+    return shared_ptr<T>(p, const_cast<typename shared_ptr<T>::element_type*>(p.get()));
+}
+
+template <typename T, typename U>
+shared_ptr<T> reinterpret_pointer_cast(const shared_ptr<U>& p) noexcept {
+    return shared_ptr<T>(p, reinterpret_cast<typename shared_ptr<T>::element_type*>(p.get()));
+}
+
+// 转换失败时返回空的 shared_ptr，不共享 p 的所有权。
+template <typename T, typename U>
+shared_ptr<T> dynamic_pointer_cast(const shared_ptr<U>& p) noexcept {
+    if (auto* ptr = dynamic_cast<typename shared_ptr<T>::element_type*>(p.get())) {
+        return shared_ptr<T>(p, ptr);
+    }
+    return shared_ptr<T>();
+}
+
+// make_shared 系列经由它调用 shared_ptr 私有的接管构造函数。
+struct _shared_ptr_access {
+    template <typename T>
+    static shared_ptr<T> adopt(typename shared_ptr<T>::element_type* ptr, control_block_base* cb) noexcept {
+        shared_ptr<T> result(ptr, cb);
+        if constexpr (!std::is_array_v<T>) {
+            result._enable_shared_from_this(ptr);
+        }
+        return result;
+    }
+};
+
+// 以 alloc 的副本（重新绑定到控制块类型）一次分配控制块与对象，
+// 对象经由重新绑定到 T 的分配器的 construct 构造，最终由同一分配器 destroy 与 deallocate。
+template <typename T, typename Alloc, typename... Args>
+    requires (!std::is_array_v<T>)
+shared_ptr<T> allocate_shared(const Alloc& alloc, Args&&... args) {
+    using block = _inplace_control_block<T, Alloc>;
+    using traits = allocator_traits<typename block::allocator_type>;
+    typename block::allocator_type a(alloc);
+    auto storage = traits::allocate(a, 1);
+    block* cb;
+    try {
+        cb = ::new (static_cast<void*>(std::to_address(storage))) block(alloc, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        traits::deallocate(a, storage, 1);
+        throw;
+    }
+    return _shared_ptr_access::adopt<T>(cb->get(), cb);
+}
+
+// 数组元素的初始化方式：值初始化、复制 u 中的元素、默认初始化。
+struct _value_init {
+    template <typename A, typename E>
+    void operator()(A& a, E* p, size_t) const {
+        allocator_traits<A>::construct(a, p);
+    }
+};
+
+// u 本身是数组时，第 i 个最内层元素复制 u 中的第 i % period 个。
+template <typename E>
+struct _fill_init {
+    const E* source;
+    size_t period;
+
+    template <typename A>
+    void operator()(A& a, E* p, size_t i) const {
+        allocator_traits<A>::construct(a, p, source[i % period]);
+    }
+};
+
+struct _default_init {
+    template <typename A, typename E>
+    void operator()(A&, E* p, size_t) const {
+        ::new (static_cast<void*>(p)) E;
+    }
+};
+
+// 数组形式的公共部分：T 的 n 个元素展开为最内层元素后交给 init 逐个构造。
+template <typename T, typename Alloc, typename Init>
+shared_ptr<T> _allocate_shared_array(const Alloc& alloc, size_t n, Init init) {
+    using E = std::remove_cv_t<std::remove_all_extents_t<T>>;
+    using block = _inplace_array_control_block<E, Alloc>;
+    constexpr size_t per_element = sizeof(std::remove_extent_t<T>) / sizeof(E);
+    if (n > SIZE_MAX / per_element) {
+        throw std::bad_array_new_length();
+    }
+    block* cb = block::create(alloc, n * per_element, init);
+    return _shared_ptr_access::adopt<T>(reinterpret_cast<std::remove_extent_t<T>*>(cb->data()), cb);
+}
+
+template <typename T>
+_fill_init<std::remove_cv_t<std::remove_all_extents_t<T>>> _fill_from(const std::remove_extent_t<T>& u) noexcept {
+    using E = std::remove_cv_t<std::remove_all_extents_t<T>>;
+    return { reinterpret_cast<const E*>(std::addressof(u)), sizeof(u) / sizeof(E) };
+}
+
+// 元素经由 alloc 值初始化。
+template <typename T, typename Alloc>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> allocate_shared(const Alloc& alloc, size_t n) {
+    return my::_allocate_shared_array<T>(alloc, n, _value_init());
+}
+
+template <typename T, typename Alloc>
+    requires std::is_bounded_array_v<T>
+shared_ptr<T> allocate_shared(const Alloc& alloc) {
+    return my::_allocate_shared_array<T>(alloc, std::extent_v<T>, _value_init());
+}
+
+// 每个元素都是 u 的副本。
+template <typename T, typename Alloc>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> allocate_shared(const Alloc& alloc, size_t n, const std::remove_extent_t<T>& u) {
+    return my::_allocate_shared_array<T>(alloc, n, my::_fill_from<T>(u));
+}
+
+template <typename T, typename Alloc>
+    requires std::is_bounded_array_v<T>
+shared_ptr<T> allocate_shared(const Alloc& alloc, const std::remove_extent_t<T>& u) {
+    return my::_allocate_shared_array<T>(alloc, std::extent_v<T>, my::_fill_from<T>(u));
+}
+
+// 对象或元素只做默认初始化：平凡类型的内容不确定，省去清零的开销。
+template <typename T, typename Alloc>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> allocate_shared_for_overwrite(const Alloc& alloc, size_t n) {
+    return my::_allocate_shared_array<T>(alloc, n, _default_init());
+}
+
+template <typename T, typename Alloc>
+    requires (!std::is_unbounded_array_v<T>)
+shared_ptr<T> allocate_shared_for_overwrite(const Alloc& alloc) {
+    if constexpr (std::is_bounded_array_v<T>) {
+        return my::_allocate_shared_array<T>(alloc, std::extent_v<T>, _default_init());
+    }
+    else {
+        using block = _inplace_control_block<T, Alloc>;
+        using traits = allocator_traits<typename block::allocator_type>;
+        typename block::allocator_type a(alloc);
+        auto storage = traits::allocate(a, 1);
+        block* cb;
+        try {
+            cb = ::new (static_cast<void*>(std::to_address(storage))) block(_for_overwrite_t(), alloc);
+        }
+        catch (...) {
+            traits::deallocate(a, storage, 1);
+            throw;
+        }
+        return _shared_ptr_access::adopt<T>(cb->get(), cb);
+    }
+}
 
-/// 还需在此实现 make_shared 和 allcoate_shared。
+// 对象与控制块一起从 my::allocator 的内存池中分配。
+template <typename T, typename... Args>
+    requires (!std::is_array_v<T>)
+shared_ptr<T> make_shared(Args&&... args) {
+    return my::allocate_shared<T>(allocator<std::remove_cv_t<T>>(), std::forward<Args>(args)...);
+}
+
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> make_shared(size_t n) {
+    return my::allocate_shared<T>(allocator<std::remove_cv_t<std::remove_all_extents_t<T>>>(), n);
+}
+
+template <typename T>
+    requires std::is_bounded_array_v<T>
+shared_ptr<T> make_shared() {
+    return my::allocate_shared<T>(allocator<std::remove_cv_t<std::remove_all_extents_t<T>>>());
+}
+
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> make_shared(size_t n, const std::remove_extent_t<T>& u) {
+    return my::allocate_shared<T>(allocator<std::remove_cv_t<std::remove_all_extents_t<T>>>(), n, u);
+}
+
+template <typename T>
+    requires std::is_bounded_array_v<T>
+shared_ptr<T> make_shared(const std::remove_extent_t<T>& u) {
+    return my::allocate_shared<T>(allocator<std::remove_cv_t<std::remove_all_extents_t<T>>>(), u);
+}
+
+template <typename T>
+    requires (!std::is_unbounded_array_v<T>)
+shared_ptr<T> make_shared_for_overwrite() {
+    return my::allocate_shared_for_overwrite<T>(allocator<std::remove_cv_t<std::remove_all_extents_t<T>>>());
+}
+
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+shared_ptr<T> make_shared_for_overwrite(size_t n) {
+    return my::allocate_shared_for_overwrite<T>(allocator<std::remove_cv_t<std::remove_all_extents_t<T>>>(), n);
+}
 
-} // namespace my
\ No newline at end of file
+} // namespace my
@@ -1,17 +1,83 @@
 #pragma once
 #include "common.hpp"
+#include "../yan_allocator.hpp"
 
 namespace my {
 
 template <typename T, typename Deleter>
 class unique_ptr_base {
 public:
+    using pointer = T*;
+    using element_type = T;
+    using deleter_type = Deleter;
 
-    /// 请在此处定义单对象版本和数组版本 unique_ptr 的共有成员。
+    constexpr unique_ptr_base() noexcept requires std::is_default_constructible_v<Deleter>
+        : pair_(nullptr) {}
+
+    constexpr unique_ptr_base(std::nullptr_t) noexcept requires std::is_default_constructible_v<Deleter>
+        : pair_(nullptr) {}
+
+    explicit unique_ptr_base(T* ptr) noexcept requires std::is_default_constructible_v<Deleter>
+        : pair_(ptr) {}
+
+    // 与 std::unique_ptr 一样按删除器的种类选取构造函数：
+    // 删除器为值时复制或移动进来；为引用时 const Deleter& 即 Deleter 本身，只绑定左值，
+    // 右值的版本被删除，不会绑定到临时对象。
+    unique_ptr_base(T* ptr, const Deleter& deleter) noexcept
+        : pair_(ptr, deleter) {}
+
+    unique_ptr_base(T* ptr, std::remove_reference_t<Deleter>&& deleter) noexcept requires (!std::is_reference_v<Deleter>)
+        : pair_(ptr, std::move(deleter)) {}
+
+    unique_ptr_base(T* ptr, std::remove_reference_t<Deleter>&& deleter) requires std::is_reference_v<Deleter> = delete;
+
+    unique_ptr_base(unique_ptr_base&& other) noexcept
+        : pair_(other.release(), std::forward<Deleter>(other.get_deleter())) {}
+
+    unique_ptr_base& operator=(unique_ptr_base&& other) noexcept {
+        reset(other.release());
+        get_deleter() = std::forward<Deleter>(other.get_deleter());
+        return *this;
+    }
+
+    unique_ptr_base& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    ~unique_ptr_base() {
+        if (pair_.first() != nullptr) {
+            get_deleter()(pair_.first());
+        }
+    }
+
+    // 放弃所有权并返回原先管理的指针。
+    T* release() noexcept {
+        return std::exchange(pair_.first(), nullptr);
+    }
+
+    // 改为管理 ptr，再删除原先管理的对象。
+    void reset(T* ptr = nullptr) noexcept {
+        T* old = std::exchange(pair_.first(), ptr);
+        if (old != nullptr) {
+            get_deleter()(old);
+        }
+    }
+
+    void swap(unique_ptr_base& other) noexcept {
+        using std::swap;
+        swap(pair_.first(), other.pair_.first());
+        swap(get_deleter(), other.get_deleter());
+    }
+
+    T* get() const noexcept { return pair_.first(); }
+    Deleter& get_deleter() noexcept { return pair_.second(); }
+    const Deleter& get_deleter() const noexcept { return pair_.second(); }
+    explicit operator bool() const noexcept { return pair_.first() != nullptr; }
 
 protected:
-    T* ptr_;
-    Deleter deleter_;
+    // 无状态的删除器不占空间，unique_ptr 与裸指针一样大。
+    _compressed_pair<T*, Deleter> pair_;
 };
 
 template <typename T, typename Deleter>
@@ -20,7 +86,27 @@ class unique_ptr : public unique_ptr_base<T, Deleter> {
 public:
     using Base::Base; // 使用基类构造函数
 
-    /// 请在此处定义单对象版本 unique_ptr 的特有成员。
+    unique_ptr() = default;
+    unique_ptr(unique_ptr&&) = default;
+    unique_ptr& operator=(unique_ptr&&) = default;
+    using Base::operator=;
+
+    // 指向派生类的 unique_ptr 可以转移给指向基类的 unique_ptr。
+    template <typename U, typename E>
+        requires (!std::is_array_v<U> && std::is_convertible_v<U*, T*> && std::is_convertible_v<E, Deleter>)
+    unique_ptr(unique_ptr<U, E>&& other) noexcept
+        : Base(other.release(), std::forward<E>(other.get_deleter())) {}
+
+    template <typename U, typename E>
+        requires (!std::is_array_v<U> && std::is_convertible_v<U*, T*> && std::is_assignable_v<Deleter&, E&&>)
+    unique_ptr& operator=(unique_ptr<U, E>&& other) noexcept {
+        this->reset(other.release());
+        this->get_deleter() = std::forward<E>(other.get_deleter());
+        return *this;
+    }
+
+    std::add_lvalue_reference_t<T> operator*() const { return *this->get(); }
+    T* operator->() const noexcept { return this->get(); }
 };
 
 template <typename T, typename Deleter>
@@ -29,9 +115,161 @@ class unique_ptr<T[], Deleter> : public unique_ptr_base<T, Deleter> {
 public:
     using Base::Base; // 使用基类构造函数
 
-    /// 请在此处定义数组版本 unique_ptr 的特有成员。
+    unique_ptr() = default;
+    unique_ptr(unique_ptr&&) = default;
+    unique_ptr& operator=(unique_ptr&&) = default;
+    using Base::operator=;
+
+    T& operator[](size_t i) const { return this->get()[i]; }
+};
+
+template <typename T, typename D, typename U, typename E>
+bool operator==(const unique_ptr<T, D>& a, const unique_ptr<U, E>& b) noexcept {
+    return a.get() == b.get();
+}
+
+template <typename T, typename D>
+bool operator==(const unique_ptr<T, D>& p, std::nullptr_t) noexcept {
+    return !p;
+}
+
+template <typename T, typename D>
+void swap(unique_ptr<T, D>& a, unique_ptr<T, D>& b) noexcept {
+    a.swap(b);
+}
+
+template <typename T, typename... Args>
+    requires (!std::is_array_v<T>)
+unique_ptr<T> make_unique(Args&&... args) {
+    return unique_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+unique_ptr<T> make_unique(size_t size) {
+    return unique_ptr<T>(new std::remove_extent_t<T>[size]());
+}
+
+// 只做默认初始化，平凡类型的内容不确定，省去清零的开销。
+template <typename T>
+    requires (!std::is_array_v<T>)
+unique_ptr<T> make_unique_for_overwrite() {
+    return unique_ptr<T>(new T);
+}
+
+template <typename T>
+    requires std::is_unbounded_array_v<T>
+unique_ptr<T> make_unique_for_overwrite(size_t size) {
+    return unique_ptr<T>(new std::remove_extent_t<T>[size]);
+}
+
+// 空的分配器以空基类优化存放，使持有它的删除器同样是空类。
+template <typename Alloc, bool = std::is_empty_v<Alloc> && !std::is_final_v<Alloc>>
+class _allocator_storage : private Alloc {
+public:
+    explicit _allocator_storage(const Alloc& alloc) : Alloc(alloc) {}
+    Alloc& get_allocator() noexcept { return *this; }
+};
+
+template <typename Alloc>
+class _allocator_storage<Alloc, false> {
+public:
+    explicit _allocator_storage(const Alloc& alloc) : alloc_(alloc) {}
+    Alloc& get_allocator() noexcept { return alloc_; }
+
+private:
+    Alloc alloc_;
 };
 
-/// 还需在此处定义 make_unique 函数。
+// allocate_unique 返回的 unique_ptr 所用的删除器：
+// 经由重新绑定到元素类型的分配器析构对象，再由同一分配器回收内存。
+template <typename T, typename Alloc>
+class allocator_delete : private _allocator_storage<typename allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>> {
+public:
+    using allocator_type = typename allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>;
+
+    allocator_delete() requires std::is_default_constructible_v<allocator_type>
+        : allocator_delete(allocator_type()) {}
+
+    explicit allocator_delete(const Alloc& alloc) : _allocator_storage<allocator_type>(allocator_type(alloc)) {}
+
+    void operator()(T* ptr) noexcept {
+        using traits = allocator_traits<allocator_type>;
+        auto* p = const_cast<std::remove_cv_t<T>*>(ptr);
+        traits::destroy(this->get_allocator(), p);
+        traits::deallocate(this->get_allocator(), p, 1);
+    }
+};
+
+// 数组形式另外记下元素个数，逆序析构各元素后回收整块内存。
+template <typename T, typename Alloc>
+class allocator_delete<T[], Alloc> : private _allocator_storage<typename allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>> {
+public:
+    using allocator_type = typename allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>;
+
+    allocator_delete() requires std::is_default_constructible_v<allocator_type>
+        : allocator_delete(allocator_type(), 0) {}
+
+    allocator_delete(const Alloc& alloc, size_t count)
+        : _allocator_storage<allocator_type>(allocator_type(alloc)), count_(count) {}
+
+    size_t size() const noexcept { return count_; }
+
+    void operator()(T* ptr) noexcept {
+        using traits = allocator_traits<allocator_type>;
+        auto* p = const_cast<std::remove_cv_t<T>*>(ptr);
+        for (size_t i = count_; i != 0; --i) {
+            traits::destroy(this->get_allocator(), p + i - 1);
+        }
+        traits::deallocate(this->get_allocator(), p, count_);
+    }
+
+private:
+    size_t count_;
+};
+
+// 经由 alloc 的副本（重新绑定到 T）分配并构造对象；构造失败时回收内存后再抛出异常。
+template <typename T, typename Alloc, typename... Args>
+    requires (!std::is_array_v<T>)
+unique_ptr<T, allocator_delete<T, Alloc>> allocate_unique(const Alloc& alloc, Args&&... args) {
+    using deleter = allocator_delete<T, Alloc>;
+    using traits = allocator_traits<typename deleter::allocator_type>;
+    typename deleter::allocator_type a(alloc);
+    auto storage = traits::allocate(a, 1);
+    auto* p = std::to_address(storage);
+    try {
+        traits::construct(a, p, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        traits::deallocate(a, storage, 1);
+        throw;
+    }
+    return unique_ptr<T, deleter>(p, deleter(alloc));
+}
+
+// 值初始化 size 个元素；某个元素构造失败时逆序析构已构造的元素并回收内存。
+template <typename T, typename Alloc>
+    requires std::is_unbounded_array_v<T>
+unique_ptr<T, allocator_delete<T, Alloc>> allocate_unique(const Alloc& alloc, size_t size) {
+    using deleter = allocator_delete<T, Alloc>;
+    using traits = allocator_traits<typename deleter::allocator_type>;
+    typename deleter::allocator_type a(alloc);
+    auto storage = traits::allocate(a, size);
+    auto* p = std::to_address(storage);
+    size_t i = 0;
+    try {
+        for (; i < size; ++i) {
+            traits::construct(a, p + i);
+        }
+    }
+    catch (...) {
+        while (i != 0) {
+            traits::destroy(a, p + --i);
+        }
+        traits::deallocate(a, storage, size);
+        throw;
+    }
+    return unique_ptr<T, deleter>(p, deleter(alloc, size));
+}
 
-} // namespace my
\ No newline at end of file
+} // namespace my
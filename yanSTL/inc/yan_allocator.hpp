@@ -1,7 +1,20 @@
 #pragma once
 #include "yan_type_traits.hpp"
+#include "allocator/large.hpp"
+#include "allocator/pool.hpp"
+#include "allocator/profile.hpp"
+#include "allocator/sample.hpp"
+#include "allocator/stats.hpp"
+#include "allocator/trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
 #include <utility>
 #include <exception>
+#include <stdexcept>
 #include <format>
 
 namespace my
@@ -27,47 +40,406 @@ public:
         return instance;
     }
 
-    // 分配 size 字节的内存
+    // 分配 size 字节的内存。
     void* allocate(size_t size)
     {
-        /// 在此处添加你的实现。
-        return nullptr;
+#ifdef YAN_ALLOC_PROFILE
+        void* ptr = _profiler.on_allocate(_raw_allocate(size + _alloc_profiler::header_size), size);
+#else
+        void* ptr = _raw_allocate(size);
+#endif
+        _record_allocate(size);
+#ifdef YAN_ALLOC_TRACE
+        _alloc_tracer::get_instance().on_allocate(ptr, size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_allocate(ptr, size);
+#endif
+        return ptr;
     }
 
     // 回收ptr指向的内存。为了记录，提供应当被回收的字节数。
     void deallocate(void* ptr, size_t size)
     {
-        /// 在此处添加你的实现。
+        if (ptr == nullptr)
+        {
+            return;
+        }
+#ifdef YAN_ALLOC_TRACE
+        // 在内存可能被别的线程重新分配之前记录，保证回放时配对正确。
+        _alloc_tracer::get_instance().on_deallocate(ptr, size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_deallocate(ptr);
+#endif
+#ifdef YAN_ALLOC_PROFILE
+        _raw_deallocate(_profiler.on_deallocate(ptr, size), size + _alloc_profiler::header_size);
+#else
+        _raw_deallocate(ptr, size);
+#endif
+        _record_deallocate(size);
+    }
+
+    // 分配 size 字节、按 alignment 对齐的内存，alignment 须为 2 的幂。
+    void* allocate(size_t size, size_t alignment)
+    {
+        if (alignment <= alignof(std::max_align_t))
+        {
+            return allocate(size);
+        }
+#ifdef YAN_ALLOC_PROFILE
+        void* ptr = _profiler.on_allocate(_raw_allocate(size + alignment, alignment), size, alignment);
+#else
+        void* ptr = _raw_allocate(size, alignment);
+#endif
+        _record_allocate(size);
+#ifdef YAN_ALLOC_TRACE
+        _alloc_tracer::get_instance().on_allocate(ptr, size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_allocate(ptr, size);
+#endif
+        return ptr;
+    }
+
+    // 回收按 alignment 对齐分配的内存，size 与 alignment 须与分配时一致。
+    void deallocate(void* ptr, size_t size, size_t alignment)
+    {
+        if (alignment <= alignof(std::max_align_t))
+        {
+            deallocate(ptr, size);
+            return;
+        }
+        if (ptr == nullptr)
+        {
+            return;
+        }
+#ifdef YAN_ALLOC_TRACE
+        // 在内存可能被别的线程重新分配之前记录，保证回放时配对正确。
+        _alloc_tracer::get_instance().on_deallocate(ptr, size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_deallocate(ptr);
+#endif
+#ifdef YAN_ALLOC_PROFILE
+        _raw_deallocate(_profiler.on_deallocate(ptr, size, alignment), size + alignment, alignment);
+#else
+        _raw_deallocate(ptr, size, alignment);
+#endif
+        _record_deallocate(size);
+    }
+
+    // 尝试把 ptr 指向的、old_size 字节的内存原地扩张到 new_size 字节（不小于 old_size）。
+    // 成功时内容与地址不变，此后以 new_size 回收；失败时什么也不做。
+    // 同一尺寸级别内的小对象与大块内存（页内余量或 mremap）可以原地扩张。
+    bool try_expand(void* ptr, size_t old_size, size_t new_size, size_t alignment = alignof(std::max_align_t))
+    {
+        if (ptr == nullptr || new_size < old_size)
+        {
+            return false;
+        }
+        alignment = std::max(alignment, alignof(std::max_align_t));
+#ifdef YAN_ALLOC_PROFILE
+        // header 为 header_size 与对齐字节数中的较大者，与 allocate 一致。
+        const size_t header = std::max(alignment, _alloc_profiler::header_size);
+        if (!_raw_try_expand(static_cast<std::byte*>(ptr) - header, old_size + header, new_size + header, alignment))
+        {
+            return false;
+        }
+        _profiler.on_expand(old_size, new_size);
+#else
+        if (!_raw_try_expand(ptr, old_size, new_size, alignment))
+        {
+            return false;
+        }
+#endif
+        _record_expand(old_size, new_size);
+#ifdef YAN_ALLOC_TRACE
+        // 记作同一地址上的一次回收与一次分配，回放时照样配对。
+        _alloc_tracer::get_instance().on_deallocate(ptr, old_size);
+        _alloc_tracer::get_instance().on_allocate(ptr, new_size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_expand(ptr, old_size, new_size);
+#endif
+        return true;
+    }
+
+    // 把 ptr 指向的、old_size 字节的内存扩大到 new_size 字节（不小于 old_size），返回新的地址，
+    // 原有内容按字节搬到新地址，因此只适用于可平凡搬移的内容。ptr 为空时等同于 allocate。
+    // 先尝试原地扩张；大块内存在 Linux 上由 mremap 整体搬移页面而不复制；
+    // 其余情况分配新块、复制后回收旧块。失败时抛出 std::bad_alloc，原内存保持不变。
+    void* reallocate(void* ptr, size_t old_size, size_t new_size, size_t alignment = alignof(std::max_align_t))
+    {
+        if (try_expand(ptr, old_size, new_size, alignment))
+        {
+            return ptr;
+        }
+        if (ptr == nullptr)
+        {
+            return allocate(new_size, alignment);
+        }
+        alignment = std::max(alignment, alignof(std::max_align_t));
+#ifdef YAN_ALLOC_TRACE
+        // 与 deallocate 一样，在旧地址可能被重新分配之前记录。
+        _alloc_tracer::get_instance().on_deallocate(ptr, old_size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_deallocate(ptr);
+#endif
+        void* fresh;
+        try
+        {
+#ifdef YAN_ALLOC_PROFILE
+            const size_t header = std::max(alignment, _alloc_profiler::header_size);
+            fresh = static_cast<std::byte*>(_raw_reallocate(static_cast<std::byte*>(ptr) - header, old_size + header, new_size + header, alignment)) + header;
+#else
+            fresh = _raw_reallocate(ptr, old_size, new_size, alignment);
+#endif
+        }
+        catch (...)
+        {
+#ifdef YAN_ALLOC_TRACE
+            _alloc_tracer::get_instance().on_allocate(ptr, old_size);
+#endif
+            throw;
+        }
+#ifdef YAN_ALLOC_PROFILE
+        _profiler.on_expand(old_size, new_size);
+#endif
+        _record_expand(old_size, new_size);
+#ifdef YAN_ALLOC_TRACE
+        _alloc_tracer::get_instance().on_allocate(fresh, new_size);
+#endif
+#ifdef YAN_ALLOC_SAMPLE
+        _alloc_sampler::on_allocate(fresh, new_size);
+#endif
+        return fresh;
+    }
+
+    // 若 size 字节、按 alignment 对齐的请求由内存池服务，返回同一块能容纳的最大字节数，否则返回 0。
+    // 以返回值代替 size 分配与回收不会多占内存，同一块由 pooled_size_of 总能得到相同的值。
+    static size_t pooled_size(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept
+    {
+        alignment = std::max(alignment, alignof(std::max_align_t));
+        const size_t header = _pooled_header(alignment);
+        if (size > _size_class::max_small || header > _size_class::max_small - size)
+        {
+            return 0;
+        }
+        const size_t cls = alignment > alignof(std::max_align_t) ? _size_class::aligned_index(size + header, alignment) : _size_class::index(size + header);
+        return cls < _size_class::count ? _size_class::size(cls) - header : 0;
+    }
+
+    // 若 ptr 指向内存池服务的块，返回它的 pooled_size，否则返回 0。
+    // 只凭地址查找所在的 slab，供不知道字节数的回收（如不带大小的 operator delete）使用。
+    static size_t pooled_size_of(const void* ptr, size_t alignment = alignof(std::max_align_t)) noexcept
+    {
+        alignment = std::max(alignment, alignof(std::max_align_t));
+        const size_t header = _pooled_header(alignment);
+        const size_t cls = _slab_map::class_of(static_cast<const std::byte*>(ptr) - header);
+        return cls < _size_class::count ? _size_class::size(cls) - header : 0;
+    }
+
+#ifdef YAN_ALLOC_TRACE
+    // 分配追踪，以 start/stop 开关，文件格式见 alloc_trace_record。
+    _alloc_tracer& tracer() noexcept
+    {
+        return _alloc_tracer::get_instance();
+    }
+#endif
+
+#ifdef YAN_ALLOC_SAMPLE
+    // 抽样分配剖析，以 set_interval 调整采样间隔，live/report 给出存活采样。
+    _alloc_sampler& sampler() noexcept
+    {
+        return _alloc_sampler::get_instance();
+    }
+#endif
+
+#ifdef YAN_ALLOC_PROFILE
+    // 分配剖析的结果，见 _alloc_profiler::report。
+    _alloc_profiler& profiler() noexcept
+    {
+        return _profiler;
+    }
+#endif
+
+    // 汇总各线程的统计分片。统计量由各线程分别累计，只在这里求和。
+    _alloc_stats snapshot() const
+    {
+        return _stat_registry::get_instance().snapshot();
     }
 
     void reset()
     {
-        if (current_allocated_bytes != 0 || current_allocations != 0)
+        const _alloc_stats stats = snapshot();
+        if (stats.current_allocated_bytes != 0 || stats.current_allocations != 0)
         {
-            throw memory_leak(current_allocated_bytes, current_allocations);
+            throw memory_leak(stats.current_allocated_bytes, stats.current_allocations);
         }
         reset_uncheck();
     }
 
-    size_t current_allocated_bytes; // 当前已分配未回收的字节数
-    size_t total_allocated_bytes;   // 总共已分配的字节数
-    size_t current_allocations;     // 尚未回收的分配数（:= allocate与deallocate的调用次数之差）
-    size_t total_allocations;       // 总共已分配的分配数 （:= allocate的调用次数）
+    // 读取时才汇总的统计量，用法与普通的 size_t 成员相同。
+    class counter
+    {
+    public:
+        explicit constexpr counter(size_t _alloc_stats::* field) noexcept : _field(field) {}
+        counter(const counter&) = delete;
+        counter& operator=(const counter&) = delete;
+
+        operator size_t() const
+        {
+            return _alloc_proxy::get_instance().snapshot().*_field;
+        }
+
+    private:
+        size_t _alloc_stats::* _field;
+    };
+
+    counter current_allocated_bytes{ &_alloc_stats::current_allocated_bytes }; // 当前已分配未回收的字节数
+    counter total_allocated_bytes{ &_alloc_stats::total_allocated_bytes };     // 总共已分配的字节数
+    counter current_allocations{ &_alloc_stats::current_allocations };         // 尚未回收的分配数（:= allocate与deallocate的调用次数之差）
+    counter total_allocations{ &_alloc_stats::total_allocations };             // 总共已分配的分配数 （:= allocate的调用次数）
 
     void reset_uncheck()
     {
-        current_allocated_bytes = 0;
-        total_allocated_bytes = 0;
-        current_allocations = 0;
-        total_allocations = 0;
+        _stat_registry::get_instance().rebase();
     }
 private:
-    _alloc_proxy()
-        : current_allocated_bytes(0), total_allocated_bytes(0),
-          current_allocations(0), total_allocations(0) {}
-    ~_alloc_proxy()
+    friend struct counter_accounting;
+    friend struct no_accounting;
+
+#ifdef YAN_ALLOC_PROFILE
+    _alloc_profiler _profiler;
+#endif
+
+    // 剖析时块前的 header 字节数，与 allocate 一致。
+    static constexpr size_t _pooled_header(size_t alignment) noexcept
+    {
+#ifdef YAN_ALLOC_PROFILE
+        return std::max(alignment, _alloc_profiler::header_size);
+#else
+        (void)alignment;
+        return 0;
+#endif
+    }
+
+    // 不做任何记录的分配。不超过 _size_class::max_small 的请求由线程缓存服务，
+    // 大块内存直接映射页面，其余交给系统堆。
+    static void* _raw_allocate(size_t size)
+    {
+        if (size <= _size_class::max_small)
+        {
+            return _thread_cache::allocate(_size_class::index(size));
+        }
+        if (size >= _large_pages::threshold)
+        {
+            return _large_pages::allocate(size);
+        }
+        return _system_heap::allocate(size);
+    }
+
+    // 分配与回收的字节数一致，据此即可找回内存来自哪一条路径。
+    static void _raw_deallocate(void* ptr, size_t size) noexcept
     {
+        if (size <= _size_class::max_small)
+        {
+            _thread_cache::deallocate(ptr, _size_class::index(size));
+        }
+        else if (size >= _large_pages::threshold)
+        {
+            _large_pages::deallocate(ptr, size);
+        }
+        else
+        {
+            _system_heap::deallocate(ptr);
+        }
     }
+
+    // 对齐要求超过 max_align_t 的分配：小对象选用字节数为 alignment 倍数的级别，
+    // 大块内存的页面天然按页对齐，其余交给系统堆的对齐分配。
+    static void* _raw_allocate(size_t size, size_t alignment)
+    {
+        if (size <= _size_class::max_small)
+        {
+            if (const size_t cls = _size_class::aligned_index(size, alignment); cls < _size_class::count)
+            {
+                return _thread_cache::allocate(cls);
+            }
+        }
+        else if (size >= _large_pages::threshold && alignment <= _large_pages::page_size())
+        {
+            return _large_pages::allocate(size);
+        }
+        return _system_heap::allocate(size, alignment);
+    }
+
+    static void _raw_deallocate(void* ptr, size_t size, size_t alignment) noexcept
+    {
+        if (size <= _size_class::max_small)
+        {
+            if (const size_t cls = _size_class::aligned_index(size, alignment); cls < _size_class::count)
+            {
+                _thread_cache::deallocate(ptr, cls);
+                return;
+            }
+        }
+        else if (size >= _large_pages::threshold && alignment <= _large_pages::page_size())
+        {
+            _large_pages::deallocate(ptr, size);
+            return;
+        }
+        _system_heap::deallocate(ptr, alignment);
+    }
+
+    // 判断 _raw_allocate 得到的块能否原地容纳 new_size 字节。
+    // 小对象须仍在同一级别；系统堆上的中等大小的块不能原地扩张。
+    static bool _raw_try_expand(void* ptr, size_t old_size, size_t new_size, size_t alignment) noexcept
+    {
+        if (old_size <= _size_class::max_small)
+        {
+            const bool aligned = alignment > alignof(std::max_align_t);
+            const size_t cls = aligned ? _size_class::aligned_index(old_size, alignment) : _size_class::index(old_size);
+            return cls < _size_class::count && new_size <= _size_class::max_small
+                && cls == (aligned ? _size_class::aligned_index(new_size, alignment) : _size_class::index(new_size));
+        }
+        if (old_size >= _large_pages::threshold && alignment <= _large_pages::page_size())
+        {
+            return _large_pages::try_expand(ptr, old_size, new_size);
+        }
+        return false;
+    }
+
+    // 不能原地扩张时的 reallocate：大块内存交给 _large_pages 搬移页面，其余分配新块并复制。
+    static void* _raw_reallocate(void* ptr, size_t old_size, size_t new_size, size_t alignment)
+    {
+        if (_raw_try_expand(ptr, old_size, new_size, alignment))
+        {
+            return ptr;
+        }
+        const bool aligned = alignment > alignof(std::max_align_t);
+        if (old_size >= _large_pages::threshold && alignment <= _large_pages::page_size())
+        {
+            return _large_pages::reallocate(ptr, old_size, new_size);
+        }
+        void* fresh = aligned ? _raw_allocate(new_size, alignment) : _raw_allocate(new_size);
+        std::memcpy(fresh, ptr, old_size);
+        if (aligned)
+        {
+            _raw_deallocate(ptr, old_size, alignment);
+        }
+        else
+        {
+            _raw_deallocate(ptr, old_size);
+        }
+        return fresh;
+    }
+
+    _alloc_proxy() = default;
+    // 可平凡析构：替换了全局 operator delete 时，静态对象析构期间仍会经由这里回收内存。
+    ~_alloc_proxy() = default;
     _alloc_proxy(const _alloc_proxy&) = delete;
     _alloc_proxy& operator=(const _alloc_proxy&) = delete;
 };
@@ -78,131 +450,457 @@ struct allocation_result {
     Size count;
 };
 
-template <typename T>
+// 常用的对齐要求，用于 allocator::allocate(n, alignment)。
+inline constexpr std::align_val_t cache_line_alignment{ 64 };
+inline constexpr std::align_val_t page_alignment{ 4096 };
+
+// allocate_at_least 的取整策略：向上取到 2 的幂个元素。
+struct pow2_rounding
+{
+    static constexpr size_t round(size_t n, size_t) noexcept
+    {
+        return n > std::numeric_limits<size_t>::max() / 2 ? n : std::bit_ceil(n);
+    }
+};
+
+// allocate_at_least 的取整策略：向上取到内存池的尺寸级别（每翻一倍分 4 级），
+// 返回该级别实际能容纳的元素个数，浪费不超过约 25%。
+struct size_class_rounding
+{
+    static constexpr size_t round(size_t n, size_t elem_size) noexcept
+    {
+        return n > std::numeric_limits<size_t>::max() / 2 / elem_size ? n : _size_class::round(n * elem_size) / elem_size;
+    }
+};
+
+// my::allocator 的记账策略。
+// full_accounting: 经由 _alloc_proxy，记录统计量，定义 YAN_ALLOC_PROFILE 时还做分配剖析；
+// counter_accounting: 只记录统计量，不做剖析，泄漏检查仍然有效；
+// no_accounting: 直接从内存池分配，不做任何记录，用于正式发布的程序。
+// 不同策略的内存布局与统计互不相通，不能混用。
+struct full_accounting
+{
+    static void* allocate(size_t size, size_t alignment)
+    {
+        return _alloc_proxy::get_instance().allocate(size, alignment);
+    }
+
+    static void deallocate(void* ptr, size_t size, size_t alignment)
+    {
+        _alloc_proxy::get_instance().deallocate(ptr, size, alignment);
+    }
+
+    static bool try_expand(void* ptr, size_t old_size, size_t new_size, size_t alignment)
+    {
+        return _alloc_proxy::get_instance().try_expand(ptr, old_size, new_size, alignment);
+    }
+
+    static void* reallocate(void* ptr, size_t old_size, size_t new_size, size_t alignment)
+    {
+        return _alloc_proxy::get_instance().reallocate(ptr, old_size, new_size, alignment);
+    }
+};
+
+struct counter_accounting
+{
+    static void* allocate(size_t size, size_t alignment)
+    {
+        void* ptr = alignment <= alignof(std::max_align_t) ? _alloc_proxy::_raw_allocate(size) : _alloc_proxy::_raw_allocate(size, alignment);
+        _record_allocate(size);
+        return ptr;
+    }
+
+    static void deallocate(void* ptr, size_t size, size_t alignment)
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+        if (alignment <= alignof(std::max_align_t))
+        {
+            _alloc_proxy::_raw_deallocate(ptr, size);
+        }
+        else
+        {
+            _alloc_proxy::_raw_deallocate(ptr, size, alignment);
+        }
+        _record_deallocate(size);
+    }
+
+    static bool try_expand(void* ptr, size_t old_size, size_t new_size, size_t alignment)
+    {
+        if (ptr == nullptr || new_size < old_size || !_alloc_proxy::_raw_try_expand(ptr, old_size, new_size, alignment))
+        {
+            return false;
+        }
+        _record_expand(old_size, new_size);
+        return true;
+    }
+
+    static void* reallocate(void* ptr, size_t old_size, size_t new_size, size_t alignment)
+    {
+        void* fresh = _alloc_proxy::_raw_reallocate(ptr, old_size, new_size, alignment);
+        _record_expand(old_size, new_size);
+        return fresh;
+    }
+};
+
+struct no_accounting
+{
+    static void* allocate(size_t size, size_t alignment)
+    {
+        return alignment <= alignof(std::max_align_t) ? _alloc_proxy::_raw_allocate(size) : _alloc_proxy::_raw_allocate(size, alignment);
+    }
+
+    static void deallocate(void* ptr, size_t size, size_t alignment) noexcept
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+        if (alignment <= alignof(std::max_align_t))
+        {
+            _alloc_proxy::_raw_deallocate(ptr, size);
+        }
+        else
+        {
+            _alloc_proxy::_raw_deallocate(ptr, size, alignment);
+        }
+    }
+
+    static bool try_expand(void* ptr, size_t old_size, size_t new_size, size_t alignment) noexcept
+    {
+        return ptr != nullptr && new_size >= old_size && _alloc_proxy::_raw_try_expand(ptr, old_size, new_size, alignment);
+    }
+
+    static void* reallocate(void* ptr, size_t old_size, size_t new_size, size_t alignment)
+    {
+        return _alloc_proxy::_raw_reallocate(ptr, old_size, new_size, alignment);
+    }
+};
+
+template <typename T, typename Rounding = pow2_rounding, typename Accounting = full_accounting>
 class allocator
 {
 public:
     // Member types
-     /// 你需要修改在此处的代码。
-    using value_type = bool;
-    using size_type = bool;
-    using difference_type = bool;
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
     using propagate_on_container_move_assignment = std::true_type;
 
+    constexpr allocator() noexcept = default;
+    template <typename U, typename R>
+    constexpr allocator(const allocator<U, R, Accounting>&) noexcept {}
+
     // Member functions
     // 分配可容纳n个元素的未初始化连续存储空间。
     [[nodiscard]] constexpr T* allocate(size_type n)
     {
-        /// 在此处添加你的实现。
-        return nullptr;
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(Accounting::allocate(n * sizeof(T), alignof(T)));
+    }
+    // 分配可容纳n个元素、按 alignment 与 alignof(T) 中较大者对齐的存储空间。
+    [[nodiscard]] T* allocate(size_type n, std::align_val_t alignment)
+    {
+        if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(Accounting::allocate(n * sizeof(T), std::max(static_cast<size_t>(alignment), alignof(T))));
     }
-    // 分配至少可容纳n个元素，实际上可容纳不小于n的最小的2的幂个元素的未初始化连续存储空间。
+    // 分配至少可容纳n个元素的未初始化连续存储空间，实际容量由 Rounding 决定：
+    // 默认为不小于n的最小的2的幂，size_class_rounding 则为所在尺寸级别的容量。
     [[nodiscard]] constexpr allocation_result<T*, size_type>
         allocate_at_least(size_type n)
     {
-        /// 在此处添加你的实现。
-        return { nullptr, 0 };
+        const size_type count = Rounding::round(n, sizeof(T));
+        return { allocate(count), count };
     }
     // 回收p所指示的、可容纳n个元素的存储空间。
     constexpr void deallocate(T* p, size_type n)
     {
-        /// 在此处添加你的实现。
+        Accounting::deallocate(p, n * sizeof(T), alignof(T));
     }
-
-    // 判断同一类模板定义的各分配器实例类型的两个对象是否相等。
-    template<typename U>
-    constexpr bool operator==(const allocator<U>&) const noexcept
+    // 回收以 allocate(n, alignment) 分配的存储空间。
+    void deallocate(T* p, size_type n, std::align_val_t alignment)
     {
-        return true;
+        Accounting::deallocate(p, n * sizeof(T), std::max(static_cast<size_t>(alignment), alignof(T)));
+    }
+    // 尝试把p所指示的、可容纳n个元素的存储空间原地扩张到可容纳new_n个元素。
+    // 成功时元素不需移动，此后以 deallocate(p, new_n) 回收；失败时什么也不做。
+    bool try_expand(T* p, size_type n, size_type new_n)
+    {
+        if (new_n > std::numeric_limits<size_type>::max() / sizeof(T))
+        {
+            return false;
+        }
+        return Accounting::try_expand(p, n * sizeof(T), new_n * sizeof(T), alignof(T));
+    }
+    // 把p所指示的、可容纳n个元素的存储空间扩大到可容纳new_n个元素（new_n不小于n），返回新的地址。
+    // 存储空间的内容按字节搬移，只适用于可平凡搬移的 T；失败时抛出 std::bad_alloc，原存储空间保持不变。
+    [[nodiscard]] T* reallocate(T* p, size_type n, size_type new_n)
+    {
+        if (new_n > std::numeric_limits<size_type>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(Accounting::reallocate(p, n * sizeof(T), new_n * sizeof(T), alignof(T)));
     }
 
-private:
-    static _alloc_proxy& _proxy()
+    // 判断同一类模板定义的各分配器实例类型的两个对象是否相等。
+    // 取整策略只影响容量，记账策略相同的实例总是相等。
+    template<typename U, typename R, typename A>
+    constexpr bool operator==(const allocator<U, R, A>&) const noexcept
     {
-        return _alloc_proxy::get_instance();
+        return std::is_same_v<Accounting, A>;
     }
 };
 
+// 若 Member<Alloc> 合法则取之，否则取 Default::type。
+template <typename Alloc, template <typename> class Member, typename Default>
+struct _alloc_member_or
+{
+    using type = typename Default::type;
+};
+
+template <typename Alloc, template <typename> class Member, typename Default>
+    requires requires { typename Member<Alloc>; }
+struct _alloc_member_or<Alloc, Member, Default>
+{
+    using type = Member<Alloc>;
+};
+
+template <typename Alloc> using _alloc_pointer_t = typename Alloc::pointer;
+template <typename Alloc> using _alloc_const_pointer_t = typename Alloc::const_pointer;
+template <typename Alloc> using _alloc_void_pointer_t = typename Alloc::void_pointer;
+template <typename Alloc> using _alloc_const_void_pointer_t = typename Alloc::const_void_pointer;
+template <typename Alloc> using _alloc_difference_type_t = typename Alloc::difference_type;
+template <typename Alloc> using _alloc_size_type_t = typename Alloc::size_type;
+template <typename Alloc> using _alloc_pocca_t = typename Alloc::propagate_on_container_copy_assignment;
+template <typename Alloc> using _alloc_pocma_t = typename Alloc::propagate_on_container_move_assignment;
+template <typename Alloc> using _alloc_pocs_t = typename Alloc::propagate_on_container_swap;
+template <typename Alloc> using _alloc_is_always_equal_t = typename Alloc::is_always_equal;
+
+template <typename Ptr, typename U>
+struct _rebind_pointer
+{
+    using type = typename std::pointer_traits<Ptr>::template rebind<U>;
+};
+
+template <typename Ptr>
+struct _pointer_difference
+{
+    using type = typename std::pointer_traits<Ptr>::difference_type;
+};
+
+template <typename Diff>
+struct _make_unsigned
+{
+    using type = std::make_unsigned_t<Diff>;
+};
+
+// 将 Alloc<T, Args...> 替换为 Alloc<U, Args...>。
+template <typename Alloc, typename U>
+struct _rebind_first_arg {};
+
+template <template <typename, typename...> class Alloc, typename T, typename... Args, typename U>
+struct _rebind_first_arg<Alloc<T, Args...>, U>
+{
+    using type = Alloc<U, Args...>;
+};
+
+// 分配器提供 rebind<U>::other 时使用之，否则替换模板的第一个实参。
+template <typename Alloc, typename U>
+struct _rebind_alloc : _rebind_first_arg<Alloc, U> {};
+
+template <typename Alloc, typename U>
+    requires requires { typename Alloc::template rebind<U>::other; }
+struct _rebind_alloc<Alloc, U>
+{
+    using type = typename Alloc::template rebind<U>::other;
+};
+
 template <typename Alloc>
 struct allocator_traits
 {
     // Member types
-    /// 你需要修改在此处的代码。
-    using allocator_type = bool;
-    using value_type = bool;
-    using pointer = bool;
-    using const_pointer = bool;
-    using void_pointer = bool;
-    using const_void_pointer = bool;
-    using difference_type = bool;
-    using size_type = bool;
-    using propagate_on_container_copy_assignment = bool;
-    using propagate_on_container_move_assignment = bool;
-    using propagate_on_container_swap = bool;
-    using is_always_equal = bool;
+    using allocator_type = Alloc;
+    using value_type = typename Alloc::value_type;
+    using pointer = typename _alloc_member_or<Alloc, _alloc_pointer_t, std::type_identity<value_type*>>::type;
+    using const_pointer = typename _alloc_member_or<Alloc, _alloc_const_pointer_t, _rebind_pointer<pointer, const value_type>>::type;
+    using void_pointer = typename _alloc_member_or<Alloc, _alloc_void_pointer_t, _rebind_pointer<pointer, void>>::type;
+    using const_void_pointer = typename _alloc_member_or<Alloc, _alloc_const_void_pointer_t, _rebind_pointer<pointer, const void>>::type;
+    using difference_type = typename _alloc_member_or<Alloc, _alloc_difference_type_t, _pointer_difference<pointer>>::type;
+    using size_type = typename _alloc_member_or<Alloc, _alloc_size_type_t, _make_unsigned<difference_type>>::type;
+    using propagate_on_container_copy_assignment = typename _alloc_member_or<Alloc, _alloc_pocca_t, std::type_identity<std::false_type>>::type;
+    using propagate_on_container_move_assignment = typename _alloc_member_or<Alloc, _alloc_pocma_t, std::type_identity<std::false_type>>::type;
+    using propagate_on_container_swap = typename _alloc_member_or<Alloc, _alloc_pocs_t, std::type_identity<std::false_type>>::type;
+    using is_always_equal = typename _alloc_member_or<Alloc, _alloc_is_always_equal_t, std::is_empty<Alloc>>::type;
 
     // Member alias templates
-    /// 你需要修改在此处的代码。
     template <typename T>
-    using rebind_alloc = void;
+    using rebind_alloc = typename _rebind_alloc<Alloc, T>::type;
     template <typename T>
-    using rebind_traits = void;
+    using rebind_traits = allocator_traits<rebind_alloc<T>>;
 
     // Member functions
     // 使用 a 申请 n 个 value_type 类型的元素所需的存储空间
     [[nodiscard]] static constexpr pointer allocate(Alloc& a, size_type n)
     {
-        /// 在此处添加你的实现。
-        return nullptr;
+        return a.allocate(n);
     }
 
     // 申请带提示的内存（如果 allocator 没有该方法，则调用无提示的 allocate）
     [[nodiscard]] static constexpr pointer allocate(Alloc& a, size_type n, const_void_pointer hint)
     {
-        /// 在此处添加你的实现。
-        return nullptr;
+        if constexpr (requires { a.allocate(n, hint); })
+        {
+            return a.allocate(n, hint);
+        }
+        else
+        {
+            return a.allocate(n);
+        }
     }
 
     // 分配至少可容纳n个元素的未初始化连续存储空间。默认返回{a.allocate(n), n}。
     [[nodiscard]] static constexpr allocation_result<pointer, size_type>
         allocate_at_least(Alloc& a, size_type n)
     {
-        /// 在此处添加你的实现。
-        return { nullptr, 0 };
+        if constexpr (requires { a.allocate_at_least(n); })
+        {
+            auto [ptr, count] = a.allocate_at_least(n);
+            return { ptr, count };
+        }
+        else
+        {
+            return { a.allocate(n), n };
+        }
+    }
+
+    // 申请按 alignment 对齐的内存。allocator 没有该方法时，
+    // 仅当 alignment 不超过 alignof(value_type) 时调用 allocate(n)，否则抛出 std::bad_alloc。
+    [[nodiscard]] static constexpr pointer allocate(Alloc& a, size_type n, std::align_val_t alignment)
+    {
+        if constexpr (requires { a.allocate(n, alignment); })
+        {
+            return a.allocate(n, alignment);
+        }
+        else
+        {
+            if (static_cast<size_t>(alignment) > alignof(value_type))
+            {
+                throw std::bad_alloc();
+            }
+            return a.allocate(n);
+        }
+    }
+
+    // 尝试把 p 所指示的、n 个元素的存储空间原地扩张到 new_n 个元素。
+    // allocator 没有该方法时返回 false，调用者应改为分配新的存储空间并搬移元素。
+    static constexpr bool try_expand(Alloc& a, pointer p, size_type n, size_type new_n)
+    {
+        if constexpr (requires { a.try_expand(p, n, new_n); })
+        {
+            return a.try_expand(p, n, new_n);
+        }
+        else
+        {
+            return false;
+        }
     }
 
     // 释放内存
     static constexpr void deallocate(Alloc& a, pointer p, size_type n)
     {
-        /// 在此处添加你的实现。
+        a.deallocate(p, n);
+    }
+
+    // 释放按 alignment 对齐申请的内存
+    static constexpr void deallocate(Alloc& a, pointer p, size_type n, std::align_val_t alignment)
+    {
+        if constexpr (requires { a.deallocate(p, n, alignment); })
+        {
+            a.deallocate(p, n, alignment);
+        }
+        else
+        {
+            a.deallocate(p, n);
+        }
     }
 
     // 在内存上构造对象
     template <typename T, typename... Args>
     static constexpr void construct(Alloc& a, T* p, Args&&... args)
     {
-        /// 在此处添加你的实现。
+        if constexpr (requires { a.construct(p, std::forward<Args>(args)...); })
+        {
+            a.construct(p, std::forward<Args>(args)...);
+        }
+        else
+        {
+            std::construct_at(p, std::forward<Args>(args)...);
+        }
     }
 
     // 销毁对象
     template <typename T>
     static constexpr void destroy(Alloc& a, T* p)
     {
-        /// 在此处添加你的实现。
+        if constexpr (requires { a.destroy(p); })
+        {
+            a.destroy(p);
+        }
+        else
+        {
+            std::destroy_at(p);
+        }
     }
 
     // 获取最大可分配的元素数量
     static constexpr size_type max_size(const Alloc& a) noexcept
     {
-        /// 在此处添加你的实现。
+        if constexpr (requires { a.max_size(); })
+        {
+            return a.max_size();
+        }
+        else
+        {
+            return std::numeric_limits<size_type>::max() / sizeof(value_type);
+        }
     }
 
     // 调用a的select_on_container_copy_construction函数。
     // 若Alloc未实现该函数，则返回a。具体含义将在后续实验深究。
     static constexpr Alloc select_on_container_copy_construction(const Alloc& a)
     {
-        /// 在此处添加你的实现。
-        return {};
+        if constexpr (requires { a.select_on_container_copy_construction(); })
+        {
+            return a.select_on_container_copy_construction();
+        }
+        else
+        {
+            return a;
+        }
     }
 };
 }
+
+#include "allocator/arena.hpp"
+#include "allocator/memory_resource.hpp"
+#include "allocator/object_pool.hpp"
+#include "allocator/uninitialized.hpp"
+
+template <typename CharT>
+struct std::formatter<my::_alloc_proxy::counter, CharT> : std::formatter<my::size_t, CharT>
+{
+    template <typename FormatContext>
+    auto format(const my::_alloc_proxy::counter& c, FormatContext& ctx) const
+    {
+        return std::formatter<my::size_t, CharT>::format(static_cast<my::size_t>(c), ctx);
+    }
+};
\ No newline at end of file
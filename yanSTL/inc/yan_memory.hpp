@@ -1,16 +1,15 @@
 #pragma once
 
-// 当完成相关实现时，删除对应的宏定义。
-#define DISMISS_UNIQUE_PTR
-#define DISMISS_SHARED_AND_WEAK_PTR
-#define DISMISS_ENABLE_SHARED_FROM_THIS
-
 #include "memory/common.hpp"
 
 #ifndef DISMISS_UNIQUE_PTR
 #include "memory/unique_ptr.hpp"
 #endif
 
+#include "memory/intrusive_ptr.hpp"
+
 #ifndef DISMISS_SHARED_AND_WEAK_PTR
 #include "memory/shared_ptr.hpp"
+#include "memory/local_shared_ptr.hpp"
+#include "memory/atomic_shared_ptr.hpp"
 #endif
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 
 namespace my
 {
@@ -7,6 +8,11 @@ namespace my
 template <typename T, typename... Args>
 inline constexpr bool is_constructible_v = __is_constructible(T, Args...);
 
+// 仅当T的对象可以用 memcpy 搬到新地址、同时视原对象为已销毁时返回真。
+// 可平凡复制的类型总是如此；其他满足条件的类型（如智能指针）可以特化为真。
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v = __is_trivially_copyable(T);
+
 
 /// 你需要修改本文件的以下内容。
 
@@ -0,0 +1,131 @@
+// 以 _alloc_proxy 替换全局的 operator new/delete（含按大小与按对齐的版本）。
+// 单独编译并链接进程序即可生效，此后未使用 my::allocator 的代码
+// （std::vector、std::function 等）也经由内存池分配并计入统计。
+// 本文件与程序的其余部分须一致地定义 YAN_ALLOC_PROFILE 等宏。
+#include "yan_allocator.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace
+{
+
+// 由内存池服务的请求按 _alloc_proxy::pooled_size 取整后直接分配，不加前缀：
+// 带大小的 delete 由字节数重新算出同一取整值，不带大小的 delete 由地址找到所在的 slab。
+// 其余的块之前留出 header 字节，其末尾的 size_t 记下请求的字节数，相对块的大小可以忽略。
+// 对齐要求超过 max_align_t 时以对齐字节数作为 header，用户地址仍然对齐。
+constexpr std::size_t _header(std::size_t alignment) noexcept
+{
+    return std::max(alignof(std::max_align_t), alignment);
+}
+
+std::size_t& _size_of(void* ptr) noexcept
+{
+    return static_cast<std::size_t*>(ptr)[-1];
+}
+
+void* _allocate(std::size_t size, std::size_t alignment)
+{
+    auto& proxy = my::_alloc_proxy::get_instance();
+    const std::size_t pooled = my::_alloc_proxy::pooled_size(size, alignment);
+    const std::size_t header = _header(alignment);
+    if (pooled == 0 && size > SIZE_MAX - header)
+    {
+        throw std::bad_alloc();
+    }
+    for (;;)
+    {
+        try
+        {
+            if (pooled != 0)
+            {
+                return proxy.allocate(pooled, alignment);
+            }
+            auto* block = static_cast<std::byte*>(proxy.allocate(size + header, alignment));
+            void* ptr = block + header;
+            _size_of(ptr) = size;
+            return ptr;
+        }
+        catch (const std::bad_alloc&)
+        {
+            // 与标准库的实现一样，先调用 new_handler 再重试。
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw;
+            }
+            handler();
+        }
+    }
+}
+
+void* _allocate_nothrow(std::size_t size, std::size_t alignment) noexcept
+{
+    try
+    {
+        return _allocate(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void _deallocate(void* ptr, std::size_t size, std::size_t alignment) noexcept
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    auto& proxy = my::_alloc_proxy::get_instance();
+    if (const std::size_t pooled = my::_alloc_proxy::pooled_size(size, alignment))
+    {
+        proxy.deallocate(ptr, pooled, alignment);
+        return;
+    }
+    const std::size_t header = _header(alignment);
+    proxy.deallocate(static_cast<std::byte*>(ptr) - header, size + header, alignment);
+}
+
+void _deallocate(void* ptr, std::size_t alignment) noexcept
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    if (const std::size_t pooled = my::_alloc_proxy::pooled_size_of(ptr, alignment))
+    {
+        my::_alloc_proxy::get_instance().deallocate(ptr, pooled, alignment);
+        return;
+    }
+    _deallocate(ptr, _size_of(ptr), alignment);
+}
+
+constexpr std::size_t _default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+} // namespace
+
+void* operator new(std::size_t size) { return _allocate(size, _default_alignment); }
+void* operator new[](std::size_t size) { return _allocate(size, _default_alignment); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return _allocate_nothrow(size, _default_alignment); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return _allocate_nothrow(size, _default_alignment); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) { return _allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return _allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return _allocate_nothrow(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return _allocate_nothrow(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* ptr) noexcept { _deallocate(ptr, _default_alignment); }
+void operator delete[](void* ptr) noexcept { _deallocate(ptr, _default_alignment); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { _deallocate(ptr, _default_alignment); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { _deallocate(ptr, _default_alignment); }
+void operator delete(void* ptr, std::size_t size) noexcept { _deallocate(ptr, size, _default_alignment); }
+void operator delete[](void* ptr, std::size_t size) noexcept { _deallocate(ptr, size, _default_alignment); }
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { _deallocate(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { _deallocate(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { _deallocate(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { _deallocate(ptr, static_cast<std::size_t>(alignment)); }
+void operator delete(void* ptr, std::size_t size, std::align_val_t alignment) noexcept { _deallocate(ptr, size, static_cast<std::size_t>(alignment)); }
+void operator delete[](void* ptr, std::size_t size, std::align_val_t alignment) noexcept { _deallocate(ptr, size, static_cast<std::size_t>(alignment)); }